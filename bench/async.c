@@ -0,0 +1,106 @@
+/*
+ * Check flushAsync against flush(). The same frames are drawn twice in
+ * deferred mode: once sent with flush() over the bit banged pins, and once
+ * with flushAsync() through a custom transport into the emulator, calling
+ * flushInterrupt() by hand as the transmit complete interrupt. The next frame
+ * is drawn while the last one is still going out, as an application would.
+ * After every frame, the emulated controller's ram has to be the same both
+ * ways, and a last flushAsync() with nothing left to send mustn't start a
+ * transfer. Built with NOKIA_ASYNC by make bench.
+ */
+
+#include "libnokiadisplay.h"
+#include "pcd8544.h"
+#include <stdio.h>
+#include <string.h>
+
+#define FRAMES 40
+// More than any one flush needs: every byte, plus addressing for each bank
+#define MAX_INTERRUPTS (LCD_WIDTH * LCD_HEIGHT / 8 + 2 * LCD_HEIGHT / 8 + 1)
+
+static uint8_t frames[FRAMES][PCD8544_BANKS][PCD8544_WIDTH];
+
+/*
+ * Draw one random change towards the next frame.
+ */
+static void drawStep(void) {
+    uint8_t x = pcd8544Random() % LCD_WIDTH, y = pcd8544Random() % LCD_HEIGHT;
+
+    switch(pcd8544Random() % 5) {
+        case 0:
+            drawPixel(x, y, 1);
+            break;
+        case 1:
+            fillRect(x, y, 1 + pcd8544Random() % (LCD_WIDTH - x),
+                    1 + pcd8544Random() % (LCD_HEIGHT - y),
+                    pcd8544Random() & 1);
+            break;
+        case 2:
+            drawText(x % (LCD_WIDTH - 30), y % (LCD_HEIGHT - 8), "flush",
+                    ROP_XOR);
+            break;
+        case 3:
+            drawLine(x, y, pcd8544Random() % LCD_WIDTH,
+                    pcd8544Random() % LCD_HEIGHT, 1);
+            break;
+        default:
+            // Rarely, the whole screen
+            if(!(pcd8544Random() & 7)) clear();
+    }
+}
+
+static void start(void) {
+    pcd8544Setup();
+    setDeferredMode(1);
+}
+
+int main(void) {
+    unsigned frame, step, interrupts;
+
+    // The reference, sent with flush()
+    start();
+    for(frame = 0; frame < FRAMES; frame++) {
+        for(step = 0; step < 20; step++) drawStep();
+        flush();
+        memcpy(frames[frame], pcd8544.ram, sizeof(frames[frame]));
+    }
+
+    // The same frames sent a byte per simulated interrupt
+    start();
+    setCustomTransport(pcd8544Write);
+    for(frame = 0; frame < FRAMES; frame++) {
+        // The first frame is drawn up front, the others while the last was
+        // being sent
+        if(frame == 0) for(step = 0; step < 20; step++) drawStep();
+        flushAsync();
+
+        for(interrupts = 0, step = 0; isFlushBusy(); interrupts++) {
+            if(interrupts == MAX_INTERRUPTS) {
+                printf("FAIL: async: frame %u never finished\n", frame);
+                return 1;
+            }
+            if(step < 20 && frame + 1 < FRAMES && interrupts % 8 == 0) {
+                drawStep();
+                step++;
+            }
+            flushInterrupt();
+        }
+        if(memcmp(frames[frame], pcd8544.ram, sizeof(frames[frame]))) {
+            printf("FAIL: async: frame %u differs from flush()\n", frame);
+            return 1;
+        }
+        for(; step < 20 && frame + 1 < FRAMES; step++) drawStep();
+    }
+
+    // Nothing left to send mustn't start a transfer
+    pcd8544ResetCounts();
+    flushAsync();
+    if(isFlushBusy() || pcd8544.counts.transactions) {
+        printf("FAIL: async: an empty flush started a transfer\n");
+        return 1;
+    }
+
+    printf("async: %u frames match flush()\n", FRAMES);
+
+    return 0;
+}
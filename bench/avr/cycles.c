@@ -0,0 +1,221 @@
+/*
+ * Cycle benchmarks for libnokiadisplay, meant to be run under a simulator
+ * such as simavr ('make cycles'). Timer 1 counts CPU cycles around each call,
+ * and the results are printed on USART0, which simavr echoes to its output.
+ * Each workload is run twice from the same starting state: once through a
+ * custom transport that only counts bytes, and once through the normal bit
+ * banging transport while counting cycles. The per bit figures in the
+ * NOKIA_STATIC_PINS doc are hand estimates, which a run with and without
+ * static pins checks.
+ *
+ * The display pins are PORTB 0-4; nothing needs to be connected.
+ */
+
+#include "libnokiadisplay.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <stdio.h>
+
+struct workload {
+    const char * name;
+    void (*setup)(void);
+    void (*run)(void);
+    uint8_t calls;
+};
+
+// Big enough for a whole screen in any layout, row-major rows being padded
+static uint8_t image[(LCD_WIDTH + 7) / 8 * LCD_HEIGHT];
+static volatile uint16_t overflows;
+static uint16_t bytes;
+static uint8_t arg;
+
+ISR(TIMER1_OVF_vect) {
+    overflows++;
+}
+
+static int uartPut(char c, FILE * stream) {
+    if(c == '\n') uartPut('\r', stream);
+    while(!(UCSR0A & _BV(UDRE0)));
+    UDR0 = c;
+    return 0;
+}
+
+static FILE uart = FDEV_SETUP_STREAM(uartPut, 0, _FDEV_SETUP_WRITE);
+
+static void countByte(uint8_t byte, uint8_t dc) {
+    bytes++;
+}
+
+static void startTimer(void) {
+    overflows = 0;
+    TCNT1 = 0;
+    TCCR1B = _BV(CS10);
+}
+
+static uint32_t stopTimer(void) {
+    uint16_t count;
+
+    TCCR1B = 0;
+    count = TCNT1;
+    // Let a pending overflow interrupt run before reading the count
+    __asm__ __volatile__("nop");
+    return ((uint32_t)overflows << 16) + count;
+}
+
+static void setupBlank(void) {
+}
+
+static void setupImage(void) {
+    drawRegionColumns(0, 0, LCD_WIDTH, LCD_HEIGHT, image, 1, 1);
+}
+
+static void runClear(void) {
+    clear();
+}
+
+static void runPixel(void) {
+    drawPixel(arg * 7 % LCD_WIDTH, arg * 13 % LCD_HEIGHT, 1);
+}
+
+static void runColumnsFull(void) {
+    drawRegionColumns(0, 0, LCD_WIDTH, LCD_HEIGHT, image, 1, 1);
+}
+
+static void runRowsFull(void) {
+    drawRegionRows(0, 0, LCD_WIDTH, LCD_HEIGHT, image, 1, 1);
+}
+
+static void runRowMajorFull(void) {
+    drawRegionRowMajor(0, 0, LCD_WIDTH, LCD_HEIGHT, image, 1);
+}
+
+static void runColumnsIcon(void) {
+    drawRegionColumns(arg * 8 % 80, 8, 8, 8, image + arg, 1, 1);
+}
+
+static void runRowsIcon(void) {
+    drawRegionRows(arg * 8 % 80, 8, 8, 8, image + arg, 1, 1);
+}
+
+static void runColumnsUnaligned(void) {
+    drawRegionColumns(5, 3, 30, 20, image, 1, 1);
+}
+
+static void runRowsUnaligned(void) {
+    drawRegionRows(5, 3, 30, 20, image, 1, 1);
+}
+
+static void runRowMajorUnaligned(void) {
+    drawRegionRowMajor(5, 3, 30, 20, image, 1);
+}
+
+static void runText(void) {
+    drawText(0, 8, "RPM 1234", 1);
+}
+
+static struct nokiaSprite sprite;
+
+static void setupSprite(void) {
+    initSprite(&sprite, image, 8, 8, 1);
+    moveSprite(&sprite, 0, 3);
+}
+
+static void runSpriteMove(void) {
+    moveSprite(&sprite, (arg + 1) * 7 % 76, 3);
+}
+
+static void runColumnsSprite(void) {
+    drawRegionColumns((arg + 1) * 7 % 76, 3, 8, 8, image, 1, 1);
+}
+
+#ifdef NOKIA_LAYERS
+static struct nokiaGray gray;
+
+static void setupGray(void) {
+    uint8_t level;
+
+    // A bar of each level, like the host bench's gray scene
+    initGray(&gray);
+    for(level = 0; level < GRAY_LEVELS; level++)
+        fillGrayRect(&gray, level*21, 0, 21, 16, level);
+    fillGrayRect(&gray, 24, 24, 36, 24, 1);
+}
+
+static void runGrayTick(void) {
+    grayTick(&gray);
+}
+#endif
+
+static const struct workload workloads[] = {
+    {"clear (full screen)", setupImage, runClear, 1},
+    {"drawPixel", setupBlank, runPixel, 50},
+    {"columns 84x48", setupBlank, runColumnsFull, 1},
+    {"rows 84x48", setupBlank, runRowsFull, 1},
+    {"row-major 84x48", setupBlank, runRowMajorFull, 1},
+    {"columns 8x8 aligned", setupBlank, runColumnsIcon, 10},
+    {"rows 8x8 aligned", setupBlank, runRowsIcon, 10},
+    {"columns 30x20 at 5,3", setupBlank, runColumnsUnaligned, 1},
+    {"rows 30x20 at 5,3", setupBlank, runRowsUnaligned, 1},
+    {"row-major 30x20 at 5,3", setupBlank, runRowMajorUnaligned, 1},
+    {"drawText 8 chars", setupBlank, runText, 1},
+    {"moveSprite 8x8 at y 3", setupSprite, runSpriteMove, 10},
+    {"columns 8x8 at y 3", setupSprite, runColumnsSprite, 10},
+#ifdef NOKIA_LAYERS
+    {"grayTick", setupGray, runGrayTick, 30},
+#endif
+};
+
+/*
+ * Helper function to get the display into the same state before each run.
+ */
+static void reset(const struct workload * w) {
+#ifdef NOKIA_STATIC_PINS
+    initStaticController();
+#else
+    initController(&PORTB, 0, &PORTB, 1, &PORTB, 2, &PORTB, 3, &PORTB, 4);
+#endif
+    setTransport(TRANSPORT_BITBANG);
+    clear();
+    w->setup();
+}
+
+int main(void) {
+    const struct workload * w;
+    uint32_t cycles, calibration;
+    uint16_t i;
+
+    DDRB = 0x1F;
+    UBRR0 = 8;
+    UCSR0B = _BV(TXEN0);
+    stdout = &uart;
+    TIMSK1 = _BV(TOIE1);
+    sei();
+
+    for(i = 0; i < sizeof(image); i++) image[i] = (i * 37) ^ (i >> 3);
+
+    startTimer();
+    calibration = stopTimer();
+
+    printf("%-22s %10s %8s %8s %8s\n", "workload", "cycles", "calls",
+            "bytes", "cyc/byte");
+    for(w = workloads; w < workloads + sizeof(workloads) / sizeof(*workloads); w++) {
+        reset(w);
+        setCustomTransport(countByte);
+        bytes = 0;
+        for(arg = 0; arg < w->calls; arg++) w->run();
+
+        reset(w);
+        startTimer();
+        for(arg = 0; arg < w->calls; arg++) w->run();
+        cycles = stopTimer() - calibration;
+
+        printf("%-22s %10lu %8u %8u %8lu\n", w->name, cycles / w->calls,
+                w->calls, bytes, bytes ? cycles / bytes : 0);
+    }
+
+    // simavr stops when the CPU sleeps with interrupts off
+    cli();
+    sleep_mode();
+    return 0;
+}
@@ -0,0 +1,498 @@
+/*
+ * Benchmarks for libnokiadisplay against the emulated PCD8544. Each workload
+ * starts from a freshly cleared display and is run twice: once drawing
+ * directly, and once in deferred mode followed by a single flush(). The
+ * traffic each one caused is printed, and the program fails if the two runs
+ * leave different contents in the controller's ram.
+ */
+
+#include "libnokiadisplay.h"
+#include "pcd8544.h"
+#include <stdio.h>
+#include <string.h>
+
+struct workload {
+    const char * name;
+    void (*run)(void);
+};
+
+#define GRAY_TICKS 300
+#define DASHBOARD_TICKS 200
+
+// Big enough for a whole screen in any layout, row-major rows being padded
+static uint8_t image[(LCD_WIDTH + 7) / 8 * LCD_HEIGHT];
+
+// A settings screen mockup (title bar, two lines of text, progress bar),
+// packed by tools/nokiapack into 162 bytes from 504
+static const uint8_t uiScreen[] = {
+    0x54, 0x30, 0xD3, 0xFF, 0x83, 0x03, 0x04, 0xC3, 0x83, 0xC3, 0x43, 0x43,
+    0x85, 0x03, 0x03, 0x43, 0x03, 0x43, 0x43, 0x86, 0x03, 0x04, 0x43, 0x83,
+    0xC3, 0x03, 0x83, 0x85, 0x03, 0x04, 0xC3, 0x03, 0x83, 0xC3, 0xC3, 0x85,
+    0x03, 0x04, 0xC3, 0xC3, 0x83, 0x83, 0xC3, 0x96, 0x03, 0x01, 0xFF, 0xFF,
+    0x83, 0x00, 0x04, 0x1A, 0x0F, 0x08, 0x0F, 0x1A, 0x85, 0x00, 0x04, 0x1B,
+    0x01, 0x1B, 0x08, 0x09, 0x85, 0x00, 0x04, 0x18, 0x0F, 0x0D, 0x0E, 0x0F,
+    0x85, 0x00, 0x04, 0x03, 0x02, 0x1B, 0x1F, 0x1C, 0x85, 0x00, 0x03, 0x1C,
+    0x0D, 0x02, 0x03, 0x97, 0x00, 0x01, 0xFF, 0xFF, 0x83, 0x00, 0x04, 0x7A,
+    0x09, 0x1F, 0x12, 0x2C, 0x85, 0x00, 0x04, 0x66, 0x09, 0x0D, 0x72, 0x5D,
+    0x85, 0x00, 0x04, 0x09, 0x5E, 0x09, 0x0D, 0x04, 0x85, 0x00, 0x04, 0x05,
+    0x71, 0x47, 0x24, 0x33, 0x85, 0x00, 0x04, 0x57, 0x13, 0x6E, 0x19, 0x36,
+    0x96, 0x00, 0x01, 0xFF, 0xFF, 0x81, 0x00, 0xAC, 0xF0, 0x9B, 0x10, 0x00,
+    0xF0, 0x81, 0x00, 0x01, 0xFF, 0xFF, 0x81, 0x80, 0xAC, 0x87, 0x9B, 0x84,
+    0x00, 0x87, 0x81, 0x80, 0x00, 0xFF,
+};
+
+static void runClear(void) {
+    clear();
+}
+
+static void runPixelStorm(void) {
+    uint16_t i;
+
+    for(i = 0; i < 200; i++)
+        drawPixel(pcd8544Random() % LCD_WIDTH, pcd8544Random() % LCD_HEIGHT, 1);
+}
+
+static void runPixelLine(void) {
+    uint8_t i;
+
+    // Many pixels landing in the same few bytes
+    for(i = 0; i < LCD_WIDTH; i++) drawPixel(i, 20 + (i & 3), 1);
+}
+
+static void runTextAligned(void) {
+    drawText(0, 0, "Hello, world!", 1);
+    drawText(0, 16, "RPM 1234", 1);
+    drawText(0, 40, "0123456789ABCD", 1);
+}
+
+static void runTextUnaligned(void) {
+    drawText(3, 5, "Hello, world!", 1);
+    drawText(0, 27, "RPM 1234", 0);
+}
+
+static void runBlitColumns(void) {
+    drawRegionColumns(0, 0, LCD_WIDTH, LCD_HEIGHT, image, 1, 1);
+}
+
+static void runBlitRows(void) {
+    drawRegionRows(0, 0, LCD_WIDTH, LCD_HEIGHT, image, 1, 1);
+}
+
+static void runBlitRowMajor(void) {
+    drawRegionRowMajor(0, 0, LCD_WIDTH, LCD_HEIGHT, image, 1);
+}
+
+static void runRowMajorUnaligned(void) {
+    drawRegionRowMajor(5, 3, 30, 20, image, 1);
+    drawRegionRowMajor(40, 11, 17, 13, image, 0);
+}
+
+static void runRegionColumnsUnaligned(void) {
+    drawRegionColumns(5, 3, 30, 20, image, 1, 1);
+    drawRegionColumns(40, 11, 17, 13, image, 0, 0);
+}
+
+static void runRegionRowsUnaligned(void) {
+    drawRegionRows(5, 3, 30, 20, image, 1, 1);
+    drawRegionRows(40, 11, 17, 13, image, 0, 0);
+}
+
+static void runIconGrid(void) {
+    uint8_t col, row;
+
+    for(row = 0; row < LCD_HEIGHT; row += 16)
+        for(col = 0; col + 8 <= LCD_WIDTH; col += 12)
+            drawRegionColumns(col, row, 8, 8, image + col + row, 1, 1);
+}
+
+static void runFillRect(void) {
+    fillRect(10, 5, 40, 20, 1);
+}
+
+static void runBarChart(void) {
+    uint8_t i, height;
+
+    drawHLine(0, LCD_HEIGHT - 1, LCD_WIDTH, 1);
+    for(i = 0; i < 10; i++) {
+        height = 4 + pcd8544Random() % 40;
+        fillRect(2 + i*8, LCD_HEIGHT - 1 - height, 6, height, 1);
+    }
+}
+
+static void runGauge(void) {
+    drawCircle(41, 47, 40, 1);
+    drawCircle(41, 47, 36, 1);
+    fillCircle(41, 47, 4, 1);
+    drawLine(41, 47, 12, 20, 1);
+    drawRect(60, 0, 24, 10, 1);
+}
+
+static void runXorCursor(void) {
+    uint8_t i;
+
+    // A block cursor moving along a line of text, drawn and erased in place
+    drawText(0, 18, "Menu item one", ROP_COPY);
+    for(i = 0; i < 5; i++) {
+        drawRegionColumns(i*6, 17, 6, 10, image, 1, ROP_XOR);
+        drawRegionColumns(i*6, 17, 6, 10, image, 1, ROP_XOR);
+    }
+}
+
+static void runCompressedScreen(void) {
+    drawCompressedRegion(0, 0, uiScreen, ROP_COPY);
+}
+
+static void runBigNumerals(void) {
+    drawFontText(2, 10, "12.5", &FONT_5X7, 3, ROP_COPY);
+}
+
+static void runConsole(void) {
+    static struct nokiaConsole console;
+    uint8_t i;
+
+    // A status screen refreshed with a few values changing, then a log line
+    // scrolling it up
+    consoleInit(&console);
+    for(i = 0; i < 4; i++) {
+        consoleSetCursor(&console, 0, 0);
+        consolePrintf(&console, "RPM  %5u\nTemp %5d\nVolt %2u.%02u\n",
+                1200 + i*5, 87 + (i >> 1), 12, 40 + i);
+    }
+    consoleSetCursor(&console, 0, 5);
+    consoleWrite(&console, "Log: started\n");
+}
+
+static void runNumber(void) {
+    static struct nokiaNumber rpm, volts;
+    uint8_t i;
+
+    // 50 refreshes of two slowly changing readings
+    initNumber(&rpm, 0, 8, 6, 2);
+    initNumber(&volts, 0, 32, 6, 1);
+    for(i = 0; i < 50; i++) {
+        drawNumber(&rpm, 1200 + i*3);
+        drawFixedPoint(&volts, 1240 - (i >> 2), 2);
+    }
+}
+
+static void runNumberText(void) {
+    char text[7];
+    uint8_t i;
+
+    // The same readings redrawn in full each time, for comparison
+    for(i = 0; i < 50; i++) {
+        snprintf(text, sizeof(text), "%6u", 1200 + i*3);
+        drawFontText(0, 8, text, &FONT_5X7, 2, ROP_COPY);
+        snprintf(text, sizeof(text), "%3u.%02u", (1240 - (i >> 2)) / 100,
+                (1240 - (i >> 2)) % 100);
+        drawText(0, 32, text, ROP_COPY);
+    }
+}
+
+static void runChart(uint8_t bulk) {
+    static struct nokiaChart chart;
+    int16_t value = 500;
+    uint8_t i;
+
+    // A random walk, 60 samples past filling the chart
+    initChart(&chart, 0, 4, 80, 40, 0, 1000, bulk);
+    for(i = 0; i < 140; i++) {
+        value += (int16_t)(pcd8544Random() % 41) - 20;
+        addChartSample(&chart, value);
+    }
+}
+
+static void runChartDiff(void) {
+    runChart(0);
+}
+
+static void runChartBulk(void) {
+    runChart(1);
+}
+
+static void runIconGridFramed(void) {
+    beginFrame();
+    runIconGrid();
+    endFrame();
+}
+
+static void runSprite(void) {
+    static struct nokiaSprite sprite;
+    uint8_t i;
+
+    // An 8x8 marker moving along a diagonal over the gauge
+    runGauge();
+    initSprite(&sprite, image, 8, 8, ROP_COPY);
+    for(i = 0; i < 40; i++) moveSprite(&sprite, 2*i, i);
+}
+
+static void runSpriteRedraw(void) {
+    uint8_t i;
+
+    // The same, clearing and redrawing the whole scene each step
+    for(i = 0; i < 40; i++) {
+        beginFrame();
+        fillRect(0, 0, LCD_WIDTH, LCD_HEIGHT, 0);
+        runGauge();
+        drawRegionColumns(2*i, i, 8, 8, image, 1, ROP_COPY);
+        endFrame();
+    }
+}
+
+static void runDashboard(uint8_t interval) {
+    uint8_t tick, i, bar, height;
+
+    // Ten sensor bars updated in random bursts between 100 Hz ticks, as if
+    // by several tasks
+    if(interval) setFrameInterval(interval);
+    for(tick = 0; tick < DASHBOARD_TICKS; tick++) {
+        for(i = pcd8544Random() % 6; i > 0; i--) {
+            bar = pcd8544Random() % 10;
+            height = 4 + pcd8544Random() % 40;
+            beginFrame();
+            fillRect(2 + bar*8, 0, 6, LCD_HEIGHT, 0);
+            fillRect(2 + bar*8, LCD_HEIGHT - height, 6, height, 1);
+            endFrame();
+        }
+        frameTick();
+        framePoll();
+    }
+}
+
+static void runDashboardBursts(void) {
+    runDashboard(0);
+}
+
+static void runDashboardPaced(void) {
+    // 25 frames a second
+    runDashboard(4);
+    setFrameInterval(0);
+}
+
+#ifdef NOKIA_LAYERS
+static void drawPopup(void) {
+    fillRect(16, 12, 52, 20, 0);
+    drawRect(16, 12, 52, 20, 1);
+    drawText(22, 18, "Low batt", ROP_OR);
+}
+
+static void runPopupLayers(void) {
+    static struct nokiaLayer background, box, contents;
+    static struct nokiaLayer * const stack[] = {&background, &box, &contents};
+
+    // A gauge with a popup shown over it and then taken away again
+    initLayer(&background, ROP_OR);
+    initLayer(&box, ROP_AND_NOT);
+    initLayer(&contents, ROP_OR);
+    setLayers(stack, 3);
+    useLayer(&background);
+    runGauge();
+    useLayer(&box);
+    fillRect(16, 12, 52, 20, 1);
+    useLayer(&contents);
+    drawPopup();
+    beginFrame();
+    showLayer(&box, 0);
+    showLayer(&contents, 0);
+    endFrame();
+    setLayers(0, 0);
+}
+
+static void runPopupRedraw(void) {
+    // The same, redrawing what was under the popup by hand
+    runGauge();
+    drawPopup();
+    beginFrame();
+    fillRect(16, 12, 52, 20, 0);
+    runGauge();
+    endFrame();
+}
+
+static void drawGrayScene(struct nokiaGray * gray) {
+    uint8_t level;
+
+    // A bar of each level across the top, and a gauge with a mid gray dial
+    for(level = 0; level < GRAY_LEVELS; level++)
+        fillGrayRect(gray, level*21, 0, 21, 16, level);
+    fillGrayRect(gray, 24, 24, 36, 24, 1);
+    useLayer(&gray->high);
+    runGauge();
+    useLayer(&gray->low);
+    runGauge();
+    useLayer(0);
+}
+
+static void runGray(void) {
+    static struct nokiaGray gray;
+    uint8_t i;
+
+    initGray(&gray);
+    drawGrayScene(&gray);
+    for(i = 0; i < 30; i++) grayTick(&gray);
+    setLayers(0, 0);
+}
+#endif
+
+#ifdef NOKIA_ROTATION
+static void runConsolePortrait(void) {
+    // The same status screen, transposed as it is sent
+    setRotation(ROTATION_90);
+    runConsole();
+}
+
+static void runBarChartFlipped(void) {
+    setRotation(ROTATION_180);
+    runBarChart();
+}
+#endif
+
+static const struct workload workloads[] = {
+    {"clear", runClear},
+    {"pixel storm (200)", runPixelStorm},
+    {"pixel line (84)", runPixelLine},
+    {"text aligned", runTextAligned},
+    {"text unaligned", runTextUnaligned},
+    {"blit columns 84x48", runBlitColumns},
+    {"blit rows 84x48", runBlitRows},
+    {"blit row-major 84x48", runBlitRowMajor},
+    {"columns unaligned", runRegionColumnsUnaligned},
+    {"rows unaligned", runRegionRowsUnaligned},
+    {"row-major unaligned", runRowMajorUnaligned},
+    {"icon grid 8x8", runIconGrid},
+    {"icon grid framed", runIconGridFramed},
+    {"fillRect 40x20", runFillRect},
+    {"bar chart", runBarChart},
+    {"gauge", runGauge},
+    {"xor cursor", runXorCursor},
+    {"compressed screen", runCompressedScreen},
+    {"big numerals x3", runBigNumerals},
+    {"console refresh", runConsole},
+    {"number widgets", runNumber},
+    {"numbers as text", runNumberText},
+    {"chart diff", runChartDiff},
+    {"chart bulk", runChartBulk},
+    {"sprite moves", runSprite},
+    {"sprite redraw", runSpriteRedraw},
+    {"dashboard bursts", runDashboardBursts},
+    {"dashboard paced", runDashboardPaced},
+#ifdef NOKIA_LAYERS
+    {"popup layers", runPopupLayers},
+    {"popup redraw", runPopupRedraw},
+    {"gray 30 ticks", runGray},
+#endif
+#ifdef NOKIA_ROTATION
+    {"console portrait", runConsolePortrait},
+    {"bar chart 180", runBarChartFlipped},
+#endif
+};
+
+/*
+ * Run a workload from a known state and return the traffic it caused. The
+ * resulting controller ram is left in pcd8544.ram.
+ */
+static struct pcd8544Counts measure(const struct workload * w, uint8_t deferred) {
+    pcd8544Setup();
+    setDeferredMode(deferred);
+    pcd8544ResetCounts();
+
+    w->run();
+    if(deferred) flush();
+
+    return pcd8544.counts;
+}
+
+static void report(const char * name, const char * mode,
+        const struct pcd8544Counts * c) {
+    printf("%-20s %-9s %7lu %7lu %7lu %8lu %5lu\n", name, mode,
+            (unsigned long)c->bytes, (unsigned long)c->commands,
+            (unsigned long)c->data, (unsigned long)c->clockEdges,
+            (unsigned long)c->transactions);
+}
+
+/*
+ * Print what frame pacing made of the dashboard's bursts.
+ */
+static void reportPacing(void) {
+    struct nokiaFrameStats stats;
+
+    pcd8544Setup();
+    runDashboard(4);
+    takeFrameStats(&stats);
+    setFrameInterval(0);
+
+    printf("\npaced dashboard: %u frames in %u ticks, %u updates coalesced, "
+            "%u dropped\n", stats.frames, DASHBOARD_TICKS, stats.coalesced,
+            stats.dropped);
+}
+
+#ifdef NOKIA_LAYERS
+/*
+ * Print the bus traffic each grayscale subframe costs once the scene is
+ * drawn. Clock edges bound the subframe rate at the PCD8544's 4 MHz maximum
+ * with a hardware transport. Bit banging takes a pin write per data and clock
+ * change, counted here too, and merging the planes takes CPU time on top of
+ * that, which 'make cycles' measures on the target.
+ */
+static void reportGray(void) {
+    static struct nokiaGray gray;
+    uint32_t edges, worst = 0;
+    unsigned i;
+
+    pcd8544Setup();
+    initGray(&gray);
+    drawGrayScene(&gray);
+    grayTick(&gray);
+
+    pcd8544ResetCounts();
+    edges = 0;
+    for(i = 0; i < GRAY_TICKS; i++) {
+        grayTick(&gray);
+        if(pcd8544.counts.clockEdges - edges > worst)
+            worst = pcd8544.counts.clockEdges - edges;
+        edges = pcd8544.counts.clockEdges;
+    }
+    setLayers(0, 0);
+
+    printf("\ngray subframes per tick: %lu bytes, %lu clock edges on average "
+            "(%lu at worst), %lu pin writes\n",
+            (unsigned long)pcd8544.counts.bytes / GRAY_TICKS,
+            (unsigned long)edges / GRAY_TICKS, (unsigned long)worst,
+            (unsigned long)pcd8544.counts.pinWrites / GRAY_TICKS);
+    printf("bus time alone at 4 MHz allows %lu subframes/s on average, %lu at "
+            "worst\n", (unsigned long)(4000000ULL * GRAY_TICKS / edges),
+            (unsigned long)(4000000UL / worst));
+}
+#endif
+
+int main(void) {
+    uint8_t direct[PCD8544_BANKS][PCD8544_WIDTH];
+    struct pcd8544Counts counts;
+    unsigned i, failures = 0;
+
+    // Roughly a quarter of the pixels on
+    for(i = 0; i < sizeof(image); i++)
+        image[i] = pcd8544Random() & pcd8544Random();
+
+    printf("%-20s %-9s %7s %7s %7s %8s %5s\n", "workload", "mode", "bytes",
+            "cmds", "data", "edges", "cs");
+    for(i = 0; i < sizeof(workloads) / sizeof(*workloads); i++) {
+        counts = measure(workloads + i, 0);
+        report(workloads[i].name, "direct", &counts);
+        memcpy(direct, pcd8544.ram, sizeof(direct));
+
+        counts = measure(workloads + i, 1);
+        report("", "deferred", &counts);
+
+        if(memcmp(direct, pcd8544.ram, sizeof(direct))) {
+            printf("FAIL: %s: deferred output differs\n", workloads[i].name);
+            failures++;
+        }
+    }
+
+    reportPacing();
+#ifdef NOKIA_LAYERS
+    reportGray();
+#endif
+
+    return failures != 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * Check how frames use CS. A frame holds CS low from the first thing sent in
+ * it until endFrame(), so everything in it is one transaction, and a frame
+ * that sends nothing never touches CS at all. Widgets open a frame on every
+ * update, so an update that changed nothing, or one made in deferred mode,
+ * mustn't cost an empty transaction.
+ */
+
+#include "libnokiadisplay.h"
+#include "pcd8544.h"
+#include <stdio.h>
+
+static unsigned failures;
+
+static void expect(const char * name, uint32_t transactions) {
+    if(pcd8544.counts.transactions != transactions) {
+        printf("FAIL: frames: %s: %lu transactions, expected %lu\n", name,
+                (unsigned long)pcd8544.counts.transactions,
+                (unsigned long)transactions);
+        failures++;
+    }
+    pcd8544ResetCounts();
+}
+
+int main(void) {
+    pcd8544Setup();
+
+    beginFrame();
+    endFrame();
+    expect("empty frame", 0);
+
+    beginFrame();
+    beginFrame();
+    endFrame();
+    endFrame();
+    expect("empty nested frames", 0);
+
+    beginFrame();
+    drawPixel(1, 1, 1);
+    fillRect(10, 10, 20, 20, 1);
+    endFrame();
+    expect("drawing", 1);
+
+    beginFrame();
+    setDisplayMode(DISPLAY_MODE_INVERSE);
+    beginFrame();
+    drawText(0, 0, "frame", ROP_COPY);
+    endFrame();
+    setDisplayMode(DISPLAY_MODE_NORMAL);
+    endFrame();
+    expect("commands and nested drawing", 1);
+
+    setDeferredMode(1);
+    pcd8544ResetCounts();
+    beginFrame();
+    drawLine(0, 0, 83, 47, 1);
+    endFrame();
+    expect("deferred frame", 0);
+    beginFrame();
+    flush();
+    endFrame();
+    expect("flush inside a frame", 1);
+    setDeferredMode(0);
+
+    if(!failures) printf("frames: chip select use as expected\n");
+
+    return failures != 0;
+}
@@ -0,0 +1,123 @@
+#include "pcd8544.h"
+#include "libnokiadisplay.h"
+#include <string.h>
+
+#define PIN(bit) (1 << (bit))
+#define PORT(bit) &pcd8544Port, PCD8544_ ## bit ## _BIT
+
+volatile uint8_t pcd8544Port = 0;
+struct pcd8544 pcd8544;
+
+static uint8_t lastPort = 0, shift = 0, bits = 0;
+static uint32_t seed = 1;
+
+void pcd8544Reset(void) {
+    memset(&pcd8544, 0, sizeof(pcd8544));
+    memset(pcd8544.ram, 0xA5, sizeof(pcd8544.ram));
+    pcd8544.powerDown = 1;
+    shift = bits = 0;
+}
+
+void pcd8544ResetCounts(void) {
+    memset(&pcd8544.counts, 0, sizeof(pcd8544.counts));
+}
+
+/*
+ * Helper function to execute a command byte.
+ */
+static void command(uint8_t byte) {
+    pcd8544.counts.commands++;
+
+    // Function set is available in both instruction sets
+    if((byte & 0xF8) == 0x20) {
+        pcd8544.powerDown = (byte >> 2) & 1;
+        pcd8544.vertical = (byte >> 1) & 1;
+        pcd8544.extended = byte & 1;
+    } else if(pcd8544.extended) {
+        if(byte & 0x80) pcd8544.vop = byte & 0x7F;
+        else if((byte & 0xF8) == 0x10) pcd8544.bias = byte & 7;
+        else if((byte & 0xFC) == 0x04) pcd8544.tc = byte & 3;
+    } else {
+        if(byte & 0x80) {
+            if((byte & 0x7F) < PCD8544_WIDTH) pcd8544.x = byte & 0x7F;
+        } else if((byte & 0xF8) == 0x40) {
+            if((byte & 7) < PCD8544_BANKS) pcd8544.y = byte & 7;
+        } else if((byte & 0xFA) == 0x08) {
+            pcd8544.displayMode = byte & 5;
+        }
+    }
+}
+
+/*
+ * Helper function to write a data byte and advance the address.
+ */
+static void data(uint8_t byte) {
+    pcd8544.counts.data++;
+    pcd8544.ram[pcd8544.y][pcd8544.x] = byte;
+
+    if(pcd8544.vertical) {
+        if(++pcd8544.y == PCD8544_BANKS) {
+            pcd8544.y = 0;
+            if(++pcd8544.x == PCD8544_WIDTH) pcd8544.x = 0;
+        }
+    } else if(++pcd8544.x == PCD8544_WIDTH) {
+        pcd8544.x = 0;
+        if(++pcd8544.y == PCD8544_BANKS) pcd8544.y = 0;
+    }
+}
+
+void pcd8544Write(uint8_t byte, uint8_t dc) {
+    pcd8544.counts.bytes++;
+    if(dc) data(byte);
+    else command(byte);
+}
+
+void pcd8544PortWritten(void) {
+    uint8_t port = pcd8544Port, changed = port ^ lastPort;
+
+    pcd8544.counts.pinWrites++;
+    lastPort = port;
+
+    if(!(port & PIN(PCD8544_RES_BIT))) {
+        // Held in reset; the ram is undefined rather than cleared
+        pcd8544.x = pcd8544.y = 0;
+        pcd8544.powerDown = 1;
+        pcd8544.vertical = pcd8544.extended = 0;
+        pcd8544.displayMode = 0;
+        shift = bits = 0;
+        return;
+    }
+
+    if(changed & PIN(PCD8544_CS_BIT)) {
+        // A partially shifted byte is discarded when CS goes high
+        shift = bits = 0;
+        if(!(port & PIN(PCD8544_CS_BIT))) pcd8544.counts.transactions++;
+    }
+
+    if(port & PIN(PCD8544_CS_BIT)) return;
+
+    if((changed & PIN(PCD8544_CLK_BIT)) && (port & PIN(PCD8544_CLK_BIT))) {
+        pcd8544.counts.clockEdges++;
+        shift = (shift << 1) | ((port >> PCD8544_DIN_BIT) & 1);
+        if(++bits == 8) {
+            pcd8544Write(shift, port & PIN(PCD8544_DC_BIT));
+            shift = bits = 0;
+        }
+    }
+}
+
+void pcd8544Setup(void) {
+    pcd8544Reset();
+    initController(PORT(RES), PORT(CS), PORT(DC), PORT(DIN), PORT(CLK));
+    defaultSetExtendedRegisters();
+    setDisplayMode(DISPLAY_MODE_NORMAL);
+    setPowerMode(1);
+    clear();
+    pcd8544ResetCounts();
+    seed = 1;
+}
+
+uint8_t pcd8544Random(void) {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
@@ -0,0 +1,81 @@
+/*
+ * pcd8544 - An emulated PCD8544 for running libnokiadisplay on a host machine.
+ * All five controller pins live on one fake port, pcd8544Port, at the bit
+ * positions below. Build the library with NOKIA_EMULATOR defined and it will
+ * call pcd8544PortWritten() after every pin change, which is when the
+ * emulator samples the port and decodes clock edges into commands and
+ * display ram writes, the same way the real controller would.
+ */
+
+#ifndef PCD8544_H
+#define PCD8544_H
+
+#include <stdint.h>
+
+#define PCD8544_RES_BIT 0
+#define PCD8544_CS_BIT 1
+#define PCD8544_DC_BIT 2
+#define PCD8544_DIN_BIT 3
+#define PCD8544_CLK_BIT 4
+
+#define PCD8544_WIDTH 84
+#define PCD8544_BANKS 6
+
+struct pcd8544Counts {
+    uint32_t clockEdges;    // Rising clock edges while enabled
+    uint32_t bytes;         // Complete bytes received
+    uint32_t commands;      // Bytes received with D/C low
+    uint32_t data;          // Bytes received with D/C high
+    uint32_t transactions;  // Falling edges on CS
+    uint32_t pinWrites;     // Calls to pcd8544PortWritten()
+};
+
+struct pcd8544 {
+    uint8_t ram[PCD8544_BANKS][PCD8544_WIDTH];
+    uint8_t x, y;
+    // Function set bits
+    uint8_t powerDown, vertical, extended;
+    // Display control (as DISPLAY_MODE_*), extended registers
+    uint8_t displayMode, vop, bias, tc;
+    struct pcd8544Counts counts;
+};
+
+extern volatile uint8_t pcd8544Port;
+extern struct pcd8544 pcd8544;
+
+/*
+ * Power on state: registers and counts cleared, display ram filled with a
+ * pattern so that bytes the library never wrote are easy to spot.
+ */
+void pcd8544Reset(void);
+
+/*
+ * Clear the counts without touching any other state.
+ */
+void pcd8544ResetCounts(void);
+
+/*
+ * Decode whatever changed on pcd8544Port since the last call.
+ */
+void pcd8544PortWritten(void);
+
+/*
+ * Receive a whole byte, bypassing the pins. Suitable for setCustomTransport()
+ * to emulate a hardware transport, in which case no clock edges are counted.
+ */
+void pcd8544Write(uint8_t byte, uint8_t dc);
+
+/*
+ * Power on the emulator and bring the library up on it the way an
+ * application would: every pin on pcd8544Port, default extended registers,
+ * normal display mode, powered up and cleared. Afterwards the counts are
+ * cleared and pcd8544Random() starts its sequence over.
+ */
+void pcd8544Setup(void);
+
+/*
+ * Deterministic pseudo random numbers, so that every run draws the same.
+ */
+uint8_t pcd8544Random(void);
+
+#endif
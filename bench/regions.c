@@ -0,0 +1,116 @@
+/*
+ * Check drawRegionColumns, drawRegionRows and drawRegionRowMajor against a
+ * per-pixel reference. Random regions of random data are drawn with every
+ * raster operation, and after each one the emulated controller's ram has to
+ * match a model screen updated one pixel at a time. The program fails on the
+ * first region that doesn't.
+ */
+
+#include "libnokiadisplay.h"
+#include "pcd8544.h"
+#include <stdio.h>
+#include <string.h>
+
+#define REGIONS 3000
+
+enum layout {
+    LAYOUT_COLUMNS,
+    LAYOUT_ROWS,
+    LAYOUT_ROW_MAJOR,
+};
+
+static const char * const layoutNames[] = {"columns", "rows", "row-major"};
+
+// Big enough for a whole screen in any of the layouts
+static uint8_t data[(LCD_WIDTH + 7) / 8 * LCD_HEIGHT];
+static uint8_t model[LCD_HEIGHT][LCD_WIDTH];
+
+/*
+ * The pixel at column/row of a region, read the simple way from its layout.
+ */
+static uint8_t sourcePixel(enum layout layout, uint8_t column, uint8_t row,
+        uint8_t width, uint8_t height, uint8_t padding) {
+    uint16_t bit;
+
+    if(layout == LAYOUT_ROW_MAJOR)
+        return data[row*((width + 7) / 8) + column/8] >> (7 - column%8) & 1;
+
+    // Both column layouts hold each column top to bottom, the top pixel in
+    // the LSB, optionally starting every column on a new byte
+    if(padding) bit = column*((height + 7) / 8 * 8) + row;
+    else bit = column*height + row;
+
+    return data[bit / 8] >> (bit % 8) & 1;
+}
+
+static void applyPixel(uint8_t * pixel, uint8_t on, uint8_t op) {
+    switch(op) {
+        case ROP_OR: *pixel |= on; break;
+        case ROP_COPY: *pixel = on; break;
+        case ROP_XOR: *pixel ^= on; break;
+        case ROP_AND_NOT: *pixel &= !on; break;
+        case ROP_INVERT: *pixel = !on; break;
+    }
+}
+
+static int matchesModel(void) {
+    uint8_t x, y;
+
+    for(y = 0; y < LCD_HEIGHT; y++)
+        for(x = 0; x < LCD_WIDTH; x++)
+            if((pcd8544.ram[y/8][x] >> (y%8) & 1) != model[y][x]) return 0;
+
+    return 1;
+}
+
+int main(void) {
+    uint8_t x, y, width, height, padding, op, column, row;
+    enum layout layout;
+    unsigned i, j;
+
+    pcd8544Setup();
+    memset(model, 0, sizeof(model));
+
+    for(i = 0; i < REGIONS; i++) {
+        layout = i % 3;
+        op = pcd8544Random() % (ROP_INVERT + 1);
+        padding = pcd8544Random() & 1;
+        // Every other run of three regions is bank and byte aligned, for the
+        // fast paths
+        if(i / 3 & 1) {
+            x = pcd8544Random() % LCD_WIDTH;
+            y = pcd8544Random() % LCD_HEIGHT;
+            width = 1 + pcd8544Random() % (LCD_WIDTH - x);
+            height = 1 + pcd8544Random() % (LCD_HEIGHT - y);
+        } else {
+            x = pcd8544Random() % LCD_WIDTH;
+            y = pcd8544Random() % (LCD_HEIGHT / 8) * 8;
+            width = 1 + pcd8544Random() % (LCD_WIDTH - x);
+            height = (1 + pcd8544Random() % ((LCD_HEIGHT - y) / 8)) * 8;
+        }
+        for(j = 0; j < sizeof(data); j++) data[j] = pcd8544Random();
+
+        if(layout == LAYOUT_COLUMNS)
+            drawRegionColumns(x, y, width, height, data, padding, op);
+        else if(layout == LAYOUT_ROWS)
+            drawRegionRows(x, y, width, height, data, padding, op);
+        else
+            drawRegionRowMajor(x, y, width, height, data, op);
+
+        for(column = 0; column < width; column++)
+            for(row = 0; row < height; row++)
+                applyPixel(&model[y + row][x + column],
+                        sourcePixel(layout, column, row, width, height,
+                                padding), op);
+
+        if(!matchesModel()) {
+            printf("FAIL: %s %ux%u at %u,%u, op %u, padding %u\n",
+                    layoutNames[layout], width, height, x, y, op, padding);
+            return 1;
+        }
+    }
+
+    printf("regions: %u match the per-pixel reference\n", REGIONS);
+
+    return 0;
+}
@@ -23,6 +23,70 @@
 #define DISPLAY_MODE_NORMAL 4
 #define DISPLAY_MODE_INVERSE 5
 
+#define TRANSPORT_BITBANG 0
+#define TRANSPORT_SPI 1
+#define TRANSPORT_USART 2
+#define TRANSPORT_CUSTOM 3
+
+// Raster operations for combining drawn pixels with the buffer. OR and COPY
+// match the old opaque parameter's false and true.
+#define ROP_OR 0
+#define ROP_COPY 1
+#define ROP_XOR 2
+#define ROP_AND_NOT 3
+#define ROP_INVERT 4
+
+// Orientations for setRotation(), clockwise, which can be combined with the
+// mirrors. Only available with NOKIA_ROTATION defined.
+#define ROTATION_0 0
+#define ROTATION_90 1
+#define ROTATION_180 2
+#define ROTATION_270 3
+#define MIRROR_X 4
+#define MIRROR_Y 8
+
+// With NOKIA_BANDED, only NOKIA_BAND_BANKS banks of the screen are held at a
+// time, so nothing that works on what is already on screen is compiled in:
+// scrolling, broadcast, and the console, number and chart widgets (see
+// drawBanded)
+#ifdef NOKIA_BANDED
+#ifndef NOKIA_BAND_BANKS
+#define NOKIA_BAND_BANKS 1
+#endif
+#if NOKIA_BAND_BANKS < 1 || NOKIA_BAND_BANKS > LCD_HEIGHT / 8
+#error "NOKIA_BAND_BANKS must be from 1 to 6"
+#endif
+#if defined(NOKIA_ROTATION) || defined(NOKIA_ASYNC) || defined(NOKIA_LAYERS)
+#error "NOKIA_BANDED can't be combined with NOKIA_ROTATION, NOKIA_ASYNC" \
+        " or NOKIA_LAYERS"
+#endif
+// The mirror would cost the whole screen again
+#ifndef NOKIA_NO_MIRROR
+#define NOKIA_NO_MIRROR
+#endif
+#endif
+
+// Columns that text and compressed regions are gathered in on the stack
+// before being drawn. Banded builds draw them a few at a time, so that no
+// temporary is anywhere near the size of a bank.
+#ifdef NOKIA_BANDED
+#define NOKIA_STRIP_WIDTH 8
+#else
+#define NOKIA_STRIP_WIDTH LCD_WIDTH
+#endif
+
+// Rotated buffers are drawn on in banks across the screen's 48 pixel side, so
+// the last bank of 84 rows is only half used
+#ifdef NOKIA_ROTATION
+#define NOKIA_BUFFER_BANKS ((LCD_WIDTH + 7) / 8)
+#define NOKIA_BUFFER_SIZE (LCD_HEIGHT * NOKIA_BUFFER_BANKS)
+#elif defined(NOKIA_BANDED)
+#define NOKIA_BUFFER_SIZE (LCD_WIDTH * NOKIA_BAND_BANKS)
+#else
+#define NOKIA_BUFFER_BANKS (LCD_HEIGHT / 8)
+#define NOKIA_BUFFER_SIZE (LCD_WIDTH * LCD_HEIGHT / 8)
+#endif
+
 extern const uint8_t SPACE[];
 extern const uint8_t BANG[];
 extern const uint8_t QUOTE[];
@@ -119,6 +183,201 @@ extern const uint8_t PIPE[];
 extern const uint8_t R_BRACE[];
 extern const uint8_t TILDE[];
 
+#ifdef NOKIA_LAYERS
+/*
+ * A plane of pixels drawn on separately from the others and merged with the
+ * ones below it into the display's buffer (see setLayers). Each is as big as
+ * the buffer. The fields are only meant to be used by the library.
+ */
+struct nokiaLayer {
+    uint8_t plane[NOKIA_BUFFER_SIZE];
+    // Range of columns per bank changed since the layers were last merged
+    uint8_t dirtyMin[NOKIA_BUFFER_BANKS], dirtyMax[NOKIA_BUFFER_BANKS];
+    uint8_t op, visible;
+};
+#endif
+
+#ifndef NOKIA_BANDED
+/*
+ * Counts kept by frame pacing (see setFrameInterval), wrapping around when
+ * they overflow.
+ */
+struct nokiaFrameStats {
+    // Frames sent
+    uint16_t frames;
+    // Drawing calls and frames merged into a later one instead of being sent
+    uint16_t coalesced;
+    // Frame slots that went by with an update waiting, because framePoll()
+    // wasn't called in time
+    uint16_t dropped;
+};
+#endif
+
+/*
+ * The state of one display, including its 504 byte buffer (528 bytes with
+ * NOKIA_ROTATION, 84 per band with NOKIA_BANDED). Several displays
+ * can be driven from one program by giving each its own one of these and
+ * switching between them with useDisplay(). The library has one built in,
+ * which is used until another is chosen. The fields are only meant to be
+ * used by the library, and depend on the same configuration defines.
+ */
+struct nokiaDisplay {
+#ifndef NOKIA_STATIC_PINS
+    volatile uint8_t * resPort, * enablePort, * selPort, * dataPort,
+            * clockPort;
+    uint8_t resMask, enableMask, selMask, dataMask, clockMask;
+#endif
+    uint8_t initialized, powerMode, x, y, deferred, frameDepth, frameSelected;
+#ifdef NOKIA_ROTATION
+    // Size of the buffer as drawn on, and how it maps to the controller
+    uint8_t width, height, banks, transform;
+#endif
+#ifdef NOKIA_BANDED
+    // The banks of the screen currently held in the buffer
+    uint8_t bandFirst, bandBanks;
+#endif
+#ifdef NOKIA_LAYERS
+    // Layers merged into the buffer, bottom first, and the one drawn on
+    struct nokiaLayer * const * layers;
+    struct nokiaLayer * target;
+    uint8_t layerCount;
+#endif
+    uint8_t buffer[NOKIA_BUFFER_SIZE];
+#ifndef NOKIA_BANDED
+    // Frame pacing: the ticks between frames (0 when off), the tick the last
+    // frame was due on, and the updates drawn since
+    uint8_t frameInterval, lastFrame;
+    uint16_t updates;
+    struct nokiaFrameStats frameStats;
+    // Range of columns per bank that differ from the controller's ram. A bank
+    // is clean when its minimum is greater than its maximum. These are always
+    // the controller's banks and columns, however the buffer is rotated.
+    uint8_t dirtyMin[LCD_HEIGHT / 8], dirtyMax[LCD_HEIGHT / 8];
+#endif
+#ifndef NOKIA_NO_MIRROR
+    // What the controller's display ram currently holds, valid once it has
+    // all been written at least once.
+    uint8_t mirror[LCD_WIDTH * LCD_HEIGHT / 8];
+    uint8_t mirrorValid;
+#endif
+};
+
+/*
+ * Make every other function act on the passed display, until this is called
+ * again. Passing null switches back to the built in display. A display still
+ * needs to be initialized (with initController) once it has been chosen.
+ *
+ * Displays can share the DIN and CLK lines as long as each has its own CS
+ * pin. With NOKIA_STATIC_PINS, every display uses the same pins, so this only
+ * switches between buffers.
+ */
+void useDisplay(struct nokiaDisplay * display);
+
+#if !defined(NOKIA_STATIC_PINS) && !defined(NOKIA_BANDED)
+/*
+ * Send the current display's whole buffer to it and to every display in the
+ * list at the same time, by asserting all of their CS and D/C pins together.
+ * The displays must share DIN and CLK with the current one. Afterwards, all
+ * of their buffers hold the current display's contents (anything pending on
+ * them is lost). Useful for putting the same boot logo or blank screen on
+ * several displays for the bus cost of one:
+ *   clear(); drawRegionColumns(...logo...); broadcast(others, 2);
+ * with deferred mode on, so nothing is sent before the broadcast.
+ *
+ * Returns false if any of the displays is not initialized, true otherwise.
+ */
+int broadcast(struct nokiaDisplay * const * displays, uint8_t count);
+#endif
+
+#ifdef NOKIA_LAYERS
+/*
+ * Layers, only available when NOKIA_LAYERS is defined. A screen can be built
+ * from a stack of layers, such as a static background, live values above it
+ * and a popup or cursor on top. Each byte of the buffer is the result of
+ * merging that byte of every shown layer from the bottom up, starting from
+ * blank, using the layer's raster operation: ROP_OR adds its pixels, ROP_XOR
+ * inverts under them, and ROP_AND_NOT clears under them. An opaque popup is
+ * an AND_NOT layer holding its box, with an OR layer for its contents above.
+ *
+ * Drawing on a layer marks it dirty the same way as drawing on the buffer,
+ * and only the dirty spans of the layers are merged again before sending, so
+ * only bytes whose result changed are sent.
+ *
+ * initLayer blanks a layer and shows it. It returns false if op is not one of
+ * the ROP_ values, true otherwise.
+ */
+int initLayer(struct nokiaLayer * layer, uint8_t op);
+
+/*
+ * Make the buffer of the current display the result of merging count layers,
+ * bottom first, and rebuild all of it. The list is kept, not copied. Passing
+ * 0 layers goes back to drawing on the buffer alone, which keeps what the
+ * old layers made of it. Setting the rotation also drops the layers.
+ *
+ * Returns false if the controller is not initialized, true otherwise.
+ */
+int setLayers(struct nokiaLayer * const * layers, uint8_t count);
+
+/*
+ * Make the drawing functions (and clear) draw on a layer of the current
+ * display, until this is called again. Passing null draws on the buffer
+ * directly, which layers overwrite wherever they change.
+ */
+void useLayer(struct nokiaLayer * layer);
+
+/*
+ * Show or hide a layer. Only the spans of each bank the layer has anything
+ * in are merged again, so hiding a popup costs the bytes it covered. A
+ * ROP_COPY or ROP_INVERT layer straight over a visible one with the same op
+ * only changes where their planes differ, so only those spans are merged.
+ *
+ * Returns false if the controller is not initialized, true otherwise.
+ */
+int showLayer(struct nokiaLayer * layer, uint8_t visible);
+
+#define GRAY_LEVELS 4
+
+/*
+ * Grayscale by temporal dithering, built on two layers, so only available
+ * with NOKIA_LAYERS. Each pixel has a level from 0 (off) to 3 (on), held as
+ * a high and a low bit plane. grayTick() shows the high plane for two
+ * subframes out of three and the low one for the third, so level 1 is on a
+ * third of the time and level 2 two thirds. It needs calling at a steady 100
+ * Hz or more (from the main loop or a timer interrupt, as long as nothing
+ * else is drawing then) for the levels to blend rather than flicker.
+ *
+ * The high plane sits over the low one, and a tick shows or hides it. Only
+ * the spans where the planes differ are merged again and sent, and nothing
+ * at all when the high plane stays up, so the cost depends on how much of
+ * the screen is gray rather than on its size. Sending only the changed bytes
+ * relies on the copy of the controller's RAM: with NOKIA_NO_MIRROR every
+ * tick resends those spans whole. The bench in bench/ reports the bus
+ * traffic per tick, and 'make cycles' the CPU time it takes on the target.
+ *
+ * initGray blanks both planes and makes them the current display's layers.
+ * Anything else can be drawn in gray by drawing it on each plane with
+ * useLayer(): on in the high plane for levels 2 and 3, and on in the low one
+ * for levels 1 and 3. setGrayPixel and fillGrayRect do that for a pixel and a
+ * rectangle, leaving drawing on the buffer afterwards.
+ *
+ * They return false if the controller is not initialized or the level is out
+ * of range, or for the same reasons as drawPixel and fillRect, true
+ * otherwise.
+ */
+struct nokiaGray {
+    struct nokiaLayer low, high;
+    struct nokiaLayer * stack[2];
+    uint8_t phase;
+};
+
+int initGray(struct nokiaGray * gray);
+int setGrayPixel(struct nokiaGray * gray, uint8_t x, uint8_t y,
+        uint8_t level);
+int fillGrayRect(struct nokiaGray * gray, uint8_t x, uint8_t y,
+        uint8_t width, uint8_t height, uint8_t level);
+int grayTick(struct nokiaGray * gray);
+#endif
+
 /*
  * Reset the controller and set the appropriate signals to it. According to the
  * PCD8544 datasheet, this should be done as soon as possible. Other functions
@@ -135,11 +394,67 @@ extern const uint8_t TILDE[];
  * Returns false (and no reset action is performed) if any bits are out of
  * range (over 7), true otherwise.
  */
+#ifndef NOKIA_STATIC_PINS
 int initController(volatile uint8_t * resPort, uint8_t resBit,
         volatile uint8_t * enablePort, uint8_t enableBit,
         volatile uint8_t * selectorPort, uint8_t selectorBit,
         volatile uint8_t * dataPort, uint8_t dataBit,
         volatile uint8_t * clockPort, uint8_t clockBit);
+#else
+/*
+ * Same as above, but for builds where the pins are fixed at compile time by
+ * defining NOKIA_STATIC_PINS along with each of:
+ *   NOKIA_RES_PORT, NOKIA_RES_BIT
+ *   NOKIA_ENABLE_PORT, NOKIA_ENABLE_BIT
+ *   NOKIA_SELECTOR_PORT, NOKIA_SELECTOR_BIT
+ *   NOKIA_DATA_PORT, NOKIA_DATA_BIT
+ *   NOKIA_CLOCK_PORT, NOKIA_CLOCK_BIT
+ * where the ports are the registers themselves (such as PORTB, not &PORTB).
+ * Every pin write then compiles to a single sbi/cbi instruction and the bit
+ * banged send loop is unrolled. Estimated by hand from the code -Os should
+ * produce, not measured, a bit then takes about 8 cycles instead of 20, and a
+ * byte about 70 instead of 170. 'make cycles' measures the real figures. The
+ * library must be built with the same definitions as the application. Ports
+ * above the bit addressable I/O range (PORTH and up on the ATmega2560) still
+ * work, but don't get the benefit.
+ *
+ * Always returns true.
+ */
+int initStaticController();
+#endif
+
+/*
+ * Choose how bytes are clocked out to the controller. Possible values are:
+ *   TRANSPORT_BITBANG: toggle the DIN/CLK pins in software (the default)
+ *   TRANSPORT_SPI: use the hardware SPI peripheral
+ *   TRANSPORT_USART: use a USART in master SPI mode (USART NOKIA_USART,
+ *                    0 unless defined otherwise)
+ * The hardware transports drive their own MOSI/SCK (or TXD/XCK) pins, so DIN
+ * and CLK must be wired to those, and the pins must be set as outputs. For
+ * SPI, the SS pin must also be an output or held high. The serial clock is
+ * the fastest F_CPU division up to NOKIA_SPI_MAX_HZ, which defaults to the
+ * PCD8544's limit of 4Mhz.
+ *
+ * Defining NOKIA_TRANSPORT to one of the values above at compile time removes
+ * the others from the send path entirely. setTransport() must still be called
+ * with that value to set up the hardware.
+ *
+ * Returns false if the controller is not initialized or the transport isn't
+ * available on this target, true otherwise.
+ */
+int setTransport(uint8_t transport);
+
+/*
+ * Send every byte through the passed function instead of a built in
+ * transport. The D/C pin is still set by the library before each call, but
+ * the byte is also passed along with dc (true for data) for convenience. This
+ * is mostly meant for driving other hardware, or a mock when testing on a
+ * host machine.
+ *
+ * Returns false if the controller is not initialized, write is null, or a
+ * different transport was fixed with NOKIA_TRANSPORT, true otherwise.
+ */
+int setCustomTransport(void (*write)(uint8_t byte, uint8_t dc));
 
 /*
  * Set the bias system, operation voltage, and temperature coefficient
@@ -178,6 +493,114 @@ int setDisplayMode(uint8_t mode);
  */
 int setPowerMode(uint8_t mode);
 
+/*
+ * Set deferred drawing mode. When true, drawing functions (including clear)
+ * only change the internal buffer and remember which columns of each bank
+ * were touched. Nothing is sent until flush() is called. When false (the
+ * default), every drawing function sends what it changed before returning.
+ * Turning deferred mode off sends anything still pending. Either way, frame
+ * pacing is turned off.
+ *
+ * Returns false if the controller is not initialized, true otherwise.
+ */
+int setDeferredMode(uint8_t mode);
+
+/*
+ * Send every part of the internal buffer changed since the last flush, as one
+ * run of bytes per bank, in a single chip select transaction. Only useful in
+ * deferred mode; otherwise there is never anything pending.
+ *
+ * After the first clear(), the library keeps a 504 byte copy of what the
+ * controller holds and only sends bytes that actually differ from it,
+ * re-addressing over unchanged runs when that is cheaper than resending them.
+ * RAM constrained builds can define NOKIA_NO_MIRROR to drop the copy, in which
+ * case every byte of each dirty span is sent.
+ *
+ * Returns false if the controller is not initialized, true otherwise.
+ */
+int flush();
+
+/*
+ * Group everything between the two calls into a single chip select
+ * transaction. Once something is sent in a frame, CS is kept low until it
+ * ends, so any commands sent in the frame (setDisplayMode() etc.) share it.
+ * Drawing functions no longer send what they changed. endFrame() then sends
+ * it all, each bank's changed span once and in order, before raising CS, and
+ * a frame in which nothing changed never touches CS. In deferred mode it is
+ * left pending for flush() instead, which can also be called inside a frame.
+ *
+ * Frames can be nested, and only the outermost endFrame() sends anything.
+ * Don't switch to another display sharing DIN and CLK inside a frame, since
+ * this one would still be listening. broadcast() is refused inside a frame.
+ *
+ * Both return false if the controller is not initialized, and endFrame() if
+ * there is no frame to end, true otherwise.
+ */
+int beginFrame();
+int endFrame();
+
+#ifdef NOKIA_ASYNC
+/*
+ * Asynchronous flushing, only available when NOKIA_ASYNC is defined since it
+ * adds a second 504 byte buffer and claims the SPI and/or USART transmit
+ * complete interrupt vectors (only the one for NOKIA_TRANSPORT, if fixed).
+ *
+ * flushAsync() copies everything pending, as flush() would send it, into the
+ * second buffer and returns right away. The bytes are then sent one per
+ * transmit complete interrupt, so drawing on the next frame can continue in
+ * the meantime. Any other function that talks to the controller waits for the
+ * transfer to finish first. When nothing is pending, no transfer is started
+ * and CS is left alone. With the bit banging transport, or inside a frame,
+ * this simply calls flush(). Global interrupts need to be enabled.
+ *
+ * isFlushBusy() returns true while a transfer is in progress, and waitFlush()
+ * blocks until it's done.
+ *
+ * flushInterrupt() advances the transfer by one byte and is what the interrupt
+ * handlers call. With a custom transport there is no interrupt, so it must be
+ * called after each byte the transport was given completes. When testing on a
+ * host, this is how a transmit complete interrupt can be simulated.
+ *
+ * flushAsync() returns false if the controller is not initialized, true
+ * otherwise.
+ */
+int flushAsync();
+uint8_t isFlushBusy();
+void waitFlush();
+void flushInterrupt(void);
+#endif
+
+#ifndef NOKIA_BANDED
+/*
+ * Frame pacing, for when drawing happens more often than the panel can show
+ * it (its response time makes anything over 20-30 frames a second a blur).
+ * setFrameInterval turns deferred mode on and sends what was drawn at most
+ * once every interval ticks, so a burst of updates costs one frame. Passing
+ * 0 turns pacing and deferred mode off, sending anything still pending, as
+ * does setDeferredMode().
+ *
+ * frameTick() advances the clock all displays are paced by, and can be
+ * called from a timer interrupt, or from the main loop whenever its own
+ * clock moves on. At 100 ticks a second, an interval of 4 gives 25 frames.
+ * framePoll() sends a frame if one is due and anything was drawn since the
+ * last, so it needs calling from the main loop more often than that, and at
+ * least every 255 ticks. It never sends from the interrupt, where it could
+ * catch drawing half done. After a quiet spell, the next update goes out on
+ * the next poll. With NOKIA_ASYNC, frames are sent with flushAsync(), and a
+ * poll while the last one is still going out waits for a later one.
+ *
+ * takeFrameStats copies the current display's counts into stats, then
+ * zeroes them.
+ *
+ * setFrameInterval and takeFrameStats return false if the controller is not
+ * initialized, true otherwise. framePoll returns true if it sent a frame.
+ */
+int setFrameInterval(uint8_t interval);
+void frameTick(void);
+uint8_t framePoll();
+int takeFrameStats(struct nokiaFrameStats * stats);
+#endif
+
 /*
  * Clear the display and internal buffer.
  *
@@ -185,6 +608,85 @@ int setPowerMode(uint8_t mode);
  */
 int clear();
 
+#ifdef NOKIA_BANDED
+/*
+ * Draw the whole screen with NOKIA_BANDED, which keeps RAM use down to
+ * NOKIA_BAND_BANKS banks (84 bytes each) instead of a 504 byte buffer. The
+ * screen is drawn a band at a time from the top: the buffer is blanked, draw
+ * is called, and the band is sent. draw should draw the whole scene with the
+ * usual functions every time, and everything outside the band is clipped
+ * away; regions entirely outside it return straight away. The scene is drawn
+ * once per band, so this trades time for RAM. Outside of draw, drawing
+ * functions have no effect. Text and compressed regions are also gathered 8
+ * columns at a time instead of a whole row, so no drawing function keeps
+ * more than 8 bytes of pixels on the stack.
+ *
+ * With one bank, the display struct takes 108 bytes on AVR. 15 of those are
+ * the pin pointers and masks, which NOKIA_STATIC_PINS drops, for 93.
+ *
+ * Nothing is remembered between calls, so functions that work on what is
+ * already on screen (scrollUp, scrollLeft, broadcast) and the console, number
+ * and chart widgets aren't available. clear() is drawBanded() with nothing to
+ * draw. Passing a null draw also blanks the screen.
+ *
+ * Returns false if the controller is not initialized, or this is called from
+ * inside draw, true otherwise.
+ */
+int drawBanded(void (*draw)(void));
+#endif
+
+#ifdef NOKIA_ROTATION
+/*
+ * Set the orientation of the screen, as one of the ROTATION_* values
+ * optionally combined with MIRROR_X and/or MIRROR_Y, which flip the picture
+ * left to right and top to bottom as seen after rotating. At 90 and 270
+ * degrees the screen is 48 pixels wide and 84 tall, and every drawing
+ * function (and anything built on them) works in those coordinates.
+ *
+ * The buffer is only turned around as it is sent, a bank at a time, so
+ * drawing costs the same in any orientation. The buffer is cleared, as its
+ * contents would no longer fit.
+ *
+ * Returns false if the controller is not initialized or the rotation is not
+ * valid, true otherwise.
+ */
+int setRotation(uint8_t rotation);
+#endif
+
+/*
+ * Get the size of the screen in its current orientation. Without
+ * NOKIA_ROTATION, these are always LCD_WIDTH and LCD_HEIGHT.
+ */
+uint8_t screenWidth();
+uint8_t screenHeight();
+
+#ifndef NOKIA_BANDED
+/*
+ * Move the whole screen up by a number of banks (8 pixel rows), blanking the
+ * banks left at the bottom. Only the columns whose contents actually change
+ * are sent, so scrolling mostly blank text costs little more than the new
+ * line.
+ *
+ * Returns false if the controller is not initialized, or banks is more than
+ * the screen's 6 (11 when rotated by 90 degrees), true otherwise.
+ */
+int scrollUp(uint8_t banks);
+
+/*
+ * Move the contents of a region left by a number of columns, blanking the
+ * columns left on its right side. Pixels outside the region are untouched.
+ * Banks the region fully covers are moved with a single memmove, and the
+ * region is sent as one run of bytes per bank, so a scrolling plot costs a
+ * pass over its bytes rather than a redraw.
+ *
+ * Returns false if the controller is not initialized, x or y are out of range,
+ * the region hangs off the edge of the screen, or columns is more than its
+ * width, true otherwise.
+ */
+int scrollLeft(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+        uint8_t columns);
+#endif
+
 /*
  * Draw a pixel to the specified x/y location. If state is true, the pixel is
  * turned on, and vice versa. The origin point is the top-left corner.
@@ -194,11 +696,67 @@ int clear();
  */
 int drawPixel(uint8_t x, uint8_t y, uint8_t state);
 
+/*
+ * Turn on (or off, if state is false) a horizontal line of pixels starting at
+ * x/y and going right, or a vertical one going down. Each bank the line
+ * crosses is changed a whole byte at a time.
+ *
+ * Returns false if the controller is not initialized, x or y are out of range,
+ * or the line goes off the edge of the screen, true otherwise.
+ */
+int drawHLine(uint8_t x, uint8_t y, uint8_t width, uint8_t state);
+int drawVLine(uint8_t x, uint8_t y, uint8_t height, uint8_t state);
+
+/*
+ * Turn on (or off, if state is false) the pixels of a rectangle whose top-left
+ * corner is at x/y. fillRect() covers the whole area and drawRect() only its
+ * one pixel wide outline. Every touched byte is sent once, in one transaction.
+ * A bar in a bar chart is a single fillRect(), or two when it shrinks: one to
+ * clear the old top, and one to draw the new one.
+ *
+ * Returns false if the controller is not initialized, x or y are out of range,
+ * or the height or width hang off the edge of the screen, true otherwise.
+ */
+int fillRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+        uint8_t state);
+int drawRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+        uint8_t state);
+
+/*
+ * Turn on (or off, if state is false) the pixels of a line between two points,
+ * both included. Pixels of the line that fall in the same byte are changed
+ * together.
+ *
+ * Returns false if the controller is not initialized, or either point is out
+ * of range, true otherwise.
+ */
+int drawLine(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t state);
+
+/*
+ * Turn on (or off, if state is false) the pixels of a circle centered on x/y.
+ * drawCircle() only draws the outline, and fillCircle() the whole disc, as one
+ * vertical span per column. Parts of the circle off the screen are clipped, so
+ * the center of a gauge can sit on the edge.
+ *
+ * Returns false if the controller is not initialized, or x or y are out of
+ * range, true otherwise.
+ */
+int drawCircle(uint8_t x, uint8_t y, uint8_t radius, uint8_t state);
+int fillCircle(uint8_t x, uint8_t y, uint8_t radius, uint8_t state);
+
 /*
  * Draw a region of the specified width and height to the screen. The passed x
  * and y coordinates are the location of the top-left corner of the region.
- * If opaque is true, bits that are off will clear the corresponding buffer
- * bits. If false, bits that are off have no effect.
+ * The op parameter is the raster operation used to combine each pixel of the
+ * region with what's already in the buffer:
+ *   ROP_OR       on pixels are turned on, off pixels have no effect
+ *   ROP_COPY     the region replaces what was there (opaque)
+ *   ROP_XOR      on pixels flip what was there, off pixels have no effect
+ *   ROP_AND_NOT  on pixels are turned off, off pixels have no effect
+ *   ROP_INVERT   the region, inverted, replaces what was there
+ * Pixels outside the region are never changed. Drawing a cursor or selection
+ * with ROP_XOR, then drawing it again, restores the background underneath
+ * without redrawing it, and only the bytes the cursor covers are sent.
  *
  * This function reads data in as columns, so the first byte corresponds to
  * coordinates (x,y) through (x,y+7), etc. When using an uneven column length, the
@@ -214,15 +772,317 @@ int drawPixel(uint8_t x, uint8_t y, uint8_t state);
  * Ultimately this function has better performance than its row counterpart.
  *
  * Returns false if the controller is not initialized, x or y are out of range,
- * or the height or width hand off the edge of the screen, true otherwise.
+ * the height or width hand off the edge of the screen, or op is not one of
+ * the ROP_ values, true otherwise.
  */
 int drawRegionColumns(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
-        const uint8_t * buf, uint8_t padding, uint8_t opaque);
+        const uint8_t * buf, uint8_t padding, uint8_t op);
 
+/*
+ * Draw a region the same as drawRegionColumns, reading the same column data
+ * layout, but filling the buffer one bank at a time instead of one column at
+ * a time. For row-major images, use drawRegionRowMajor instead.
+ */
 int drawRegionRows(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
-        const uint8_t * buf, uint8_t padding, uint8_t opaque);
+        const uint8_t * buf, uint8_t padding, uint8_t op);
+
+/*
+ * Draw a region from a row-major image, the format most image tools export
+ * (such as the data of a PBM file). Each row starts on a new byte, with the
+ * leftmost pixel in the MSB, so every row takes (width + 7) / 8 bytes. The
+ * other parameters work the same as for drawRegionColumns.
+ *
+ * The image is converted 8x8 pixels at a time with a bit transpose straight
+ * into the buffer's column layout, rather than a pixel at a time.
+ *
+ * Returns false if the controller is not initialized, x or y are out of range,
+ * the height or width hand off the edge of the screen, or op is not one of
+ * the ROP_ values, true otherwise.
+ */
+int drawRegionRowMajor(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+        const uint8_t * buf, uint8_t op);
+
+/*
+ * Draw a region stored in the compressed format made by the nokiapack tool
+ * ('make tools', then 'tools/nokiapack image.pbm name > image.c'). The data
+ * starts with the region's width and height, followed by run length encoded
+ * strips of column bytes 8 pixels tall, and must be in flash (PROGMEM). The
+ * x/y and op parameters work the same as for drawRegionColumns.
+ *
+ * Mostly blank screens compress several times over, and are decoded a strip
+ * at a time straight into the buffer, so no RAM is needed for the whole image.
+ * Since it is drawn inside a frame (see beginFrame), the result is still sent
+ * as a single run of bytes per bank.
+ *
+ * Returns false if the controller is not initialized, x or y are out of range,
+ * the region hangs off the edge of the screen, or op is not one of the ROP_
+ * values, true otherwise.
+ */
+int drawCompressedRegion(uint8_t x, uint8_t y, const uint8_t * data,
+        uint8_t op);
+
+#ifndef NOKIA_BANDED
+#define SPRITE_MAX_SIZE 16
+// Banks a sprite can cover once shifted down to a row within a bank
+#define SPRITE_BANKS ((SPRITE_MAX_SIZE + 7 + 7) / 8)
+
+/*
+ * A small image that moves over the screen, up to 16x16 pixels. It keeps the
+ * bytes it covers, so moving or hiding it puts back what was under it without
+ * the application redrawing anything. The fields are only meant to be used
+ * by the sprite functions.
+ */
+struct nokiaSprite {
+    const uint8_t * data;
+    uint8_t width, height, op, x, y, shown, shift;
+    // The image shifted down to the current row within a bank, as the bytes
+    // and mask for each bank it covers
+    uint8_t shifted[SPRITE_BANKS][SPRITE_MAX_SIZE], masks[SPRITE_BANKS];
+    uint8_t saved[SPRITE_BANKS][SPRITE_MAX_SIZE];
+};
+
+/*
+ * Set up a sprite from data laid out as for drawRegionColumns with padding
+ * on, which is kept rather than copied. op works the same as for
+ * drawRegionColumns over the sprite's rectangle, so ROP_OR leaves the
+ * background showing through and ROP_COPY doesn't. Nothing is drawn until the
+ * sprite is moved.
+ *
+ * Returns false if the width or height are 0 or more than SPRITE_MAX_SIZE, or
+ * op is not one of the ROP_ values, true otherwise.
+ */
+int initSprite(struct nokiaSprite * sprite, const uint8_t * data,
+        uint8_t width, uint8_t height, uint8_t op);
+
+/*
+ * Show a sprite with its top-left corner at x/y, first putting back what was
+ * under it if it was already shown. Only the columns of the old and new
+ * positions are sent, together. The image is shifted for the row within a
+ * bank only when that changes, so moving sideways or by whole banks merges
+ * whole bytes with no shifting.
+ *
+ * Sprites that overlap must be hidden in the reverse order they were shown,
+ * and anything else drawn under a shown sprite is lost when it moves.
+ *
+ * Returns false if the controller is not initialized or the sprite would hang
+ * off the edge of the screen, true otherwise.
+ */
+int moveSprite(struct nokiaSprite * sprite, uint8_t x, uint8_t y);
+
+/*
+ * Put back what was under a sprite and stop showing it.
+ *
+ * Returns false if the controller is not initialized, true otherwise.
+ */
+int hideSprite(struct nokiaSprite * sprite);
+#endif
+
+/*
+ * Draw a string with the built in 5x7 font, where every character is 6 pixels
+ * wide (including a blank column on the right) and 8 pixels tall. The passed x
+ * and y coordinates are the location of the top-left corner of the first
+ * character, and op works the same as for drawRegionColumns. Characters
+ * outside the printable ASCII range are drawn as '?', and the string is cut
+ * off at the right edge of the screen.
+ *
+ * The font is read from flash, and the whole string is drawn as one region,
+ * so it is sent as a single run of bytes per bank it covers.
+ *
+ * Returns false if the controller is not initialized, x is out of range, y is
+ * too low for a character to fit, or op is not one of the ROP_ values, true
+ * otherwise.
+ */
+int drawText(uint8_t x, uint8_t y, const char * str, uint8_t op);
+
+#ifndef NOKIA_BANDED
+#define CONSOLE_COLUMNS (LCD_WIDTH / 6)
+#define CONSOLE_ROWS (LCD_HEIGHT / 8)
 
-int drawText(uint8_t x, uint8_t y, const char * str, uint8_t opaque);
+/*
+ * A text console covering the whole screen, as 14 columns by 6 rows of the
+ * built in font (8 by 10 when rotated by 90 degrees). It keeps the character
+ * shown in every cell, so writing the same text over itself (a status screen
+ * being refreshed) sends nothing, and changing a value only redraws the
+ * cells that differ. The fields are only meant to be used by the console
+ * functions.
+ */
+struct nokiaConsole {
+    char cells[CONSOLE_ROWS * CONSOLE_COLUMNS];
+    uint8_t columns, rows, column, row;
+};
+
+/*
+ * Blank the screen and the console, and move the cursor to the top-left. The
+ * console takes the size of the screen in its orientation at the time.
+ * Anything drawn on the screen afterwards, other than by the console
+ * functions, is not known to the console, and will only be overwritten where
+ * cells change.
+ *
+ * Returns false if the controller is not initialized, true otherwise.
+ */
+int consoleInit(struct nokiaConsole * console);
+
+/*
+ * Move the cursor to a cell, where the next character will be written.
+ *
+ * Returns false if the column or row are out of range, true otherwise.
+ */
+int consoleSetCursor(struct nokiaConsole * console, uint8_t column,
+        uint8_t row);
+
+/*
+ * Write a string at the cursor, moving it along. Text wraps onto the next row
+ * at the right edge, '\n' moves to the start of the next row, '\r' to the
+ * start of the current one, and '\f' blanks the console. Moving past the last
+ * row scrolls everything up a row with scrollUp(). Characters outside the
+ * printable ASCII range are drawn as '?'.
+ *
+ * consolePrintf formats the string first, the same as printf, up to a whole
+ * screen (84 characters) of output.
+ *
+ * The whole write is done in one frame (see beginFrame), and only cells whose
+ * character changed are drawn.
+ *
+ * Returns false if the controller is not initialized, true otherwise.
+ */
+int consoleWrite(struct nokiaConsole * console, const char * str);
+int consolePrintf(struct nokiaConsole * console, const char * format, ...);
+
+#define NUMBER_MAX_WIDTH (LCD_WIDTH / 6)
+
+/*
+ * A number shown in a fixed field of the screen, with the built in font. It
+ * keeps the characters last drawn, so each update only redraws the ones that
+ * changed. The fields are only meant to be used by the number functions.
+ */
+struct nokiaNumber {
+    uint8_t x, y, width, scale;
+    char shown[NUMBER_MAX_WIDTH];
+};
+
+/*
+ * Set up a number field width characters wide, with its top-left corner at
+ * x/y, drawn at scale times the font's size (see drawFontText). Nothing is
+ * drawn until the first update.
+ *
+ * Returns false if x or y are out of range, width or scale are 0, or the field
+ * doesn't fit on the screen, true otherwise.
+ */
+int initNumber(struct nokiaNumber * number, uint8_t x, uint8_t y,
+        uint8_t width, uint8_t scale);
+
+/*
+ * Show a value in a number field, right aligned with a leading '-' when
+ * negative. For drawFixedPoint, the value is in units of 10^-decimals, so
+ * drawFixedPoint(&volts, 1240, 2) shows "12.40". If the value doesn't fit,
+ * the field is filled with '#'.
+ *
+ * Formatting is done without printf, and only runs of characters that differ
+ * from what the field already shows are redrawn, all in one frame (see
+ * beginFrame). A reading going from 1234 to 1235 only redraws and sends its
+ * last digit.
+ *
+ * Returns false if the controller is not initialized, true otherwise.
+ */
+int drawNumber(struct nokiaNumber * number, int32_t value);
+int drawFixedPoint(struct nokiaNumber * number, int32_t value,
+        uint8_t decimals);
+
+/*
+ * A trend plot of the last width samples, in a region of the screen. Samples
+ * are drawn left to right as a line, one per column, and once the region is
+ * full each new sample scrolls the plot left by a column. The fields are only
+ * meant to be used by the chart functions.
+ */
+struct nokiaChart {
+    int16_t minimum, maximum;
+    uint8_t x, y, width, height, bulk;
+    // Ring buffer of samples, as rows within the region (0 at the top)
+    uint8_t rows[LCD_WIDTH];
+    uint8_t head, count;
+};
+
+/*
+ * Set up a chart in the region with its top-left corner at x/y. Samples are
+ * scaled so that minimum is plotted on the bottom row and maximum on the top
+ * row, and clamped to those. The region is blanked.
+ *
+ * How the plot scrolls is picked by bulk. When false, only the columns whose
+ * pixels differ from what they showed are redrawn, which suits slowly
+ * changing values. When true, the whole region is moved with scrollLeft,
+ * the new column is drawn and the leftmost one trimmed to a point, which does
+ * less work for noisy ones.
+ *
+ * Returns false if the controller is not initialized, x or y are out of range,
+ * the region hangs off the edge of the screen, width or height are 0, or
+ * maximum is not greater than minimum, true otherwise.
+ */
+int initChart(struct nokiaChart * chart, uint8_t x, uint8_t y, uint8_t width,
+        uint8_t height, int16_t minimum, int16_t maximum, uint8_t bulk);
+
+/*
+ * Add a sample to a chart and update it on the screen, in one frame (see
+ * beginFrame).
+ *
+ * Returns false if the controller is not initialized, true otherwise.
+ */
+int addChartSample(struct nokiaChart * chart, int16_t value);
+#endif
+
+/*
+ * A font for drawFontText. All of the arrays it points to are kept in flash
+ * (PROGMEM), and the descriptor itself is small enough for RAM.
+ *
+ * bitmap holds every glyph's columns in the same layout as drawRegionColumns
+ * with padding on: each column is (height + 7) / 8 bytes, top pixel first in
+ * the LSB, and a glyph's columns follow each other. Glyphs can be any height
+ * up to the screen's. For a proportional font, widths and offsets give each
+ * glyph's width in columns and the byte offset of its first column in bitmap.
+ * For a monospaced font they can both be null, in which case every glyph is
+ * width columns wide and they are stored back to back.
+ *
+ * The font covers count characters starting at first. spacing blank columns
+ * are drawn after each glyph.
+ */
+struct nokiaFont {
+    const uint8_t * bitmap;
+    const uint8_t * widths;
+    const uint16_t * offsets;
+    char first;
+    uint8_t count, width, height, spacing;
+};
+
+/*
+ * The built in 5x7 font used by drawText, as a font.
+ */
+extern const struct nokiaFont FONT_5X7;
+
+/*
+ * Return the width in pixels of a string drawn with drawFontText, including
+ * the spacing after its last character. It may be wider than the screen.
+ */
+uint16_t measureText(const char * str, const struct nokiaFont * font,
+        uint8_t scale);
+
+/*
+ * Draw a string with the passed font, every pixel of it scaled up to scale by
+ * scale pixels, so a large reading can be made from any font:
+ *   drawFontText(0, 10, "12.5", &FONT_5X7, 3, ROP_COPY);
+ * The passed x and y coordinates are the location of the top-left corner of
+ * the first character, and op works the same as for drawRegionColumns.
+ * Characters the font doesn't have are drawn as '?', if it has that, and the
+ * string is cut off at the right edge of the screen.
+ *
+ * The string is measured first, then drawn one 8 pixel tall strip at a time
+ * across its whole width, so every bank is filled in a single pass and sent
+ * as a single run of bytes.
+ *
+ * Returns false if the controller is not initialized, x or y are out of range,
+ * the scaled font is too tall to fit below y, scale is 0, or op is not one of
+ * the ROP_ values, true otherwise.
+ */
+int drawFontText(uint8_t x, uint8_t y, const char * str,
+        const struct nokiaFont * font, uint8_t scale, uint8_t op);
 
 void love(void);
 #endif
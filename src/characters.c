@@ -1,131 +1,256 @@
 #include "libnokiadisplay.h"
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#endif
 
-const uint8_t SPACE[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0};
-const uint8_t BANG[] = {0x00, 0x00, 0x4F, 0x00, 0x00, 0};
-const uint8_t QUOTE[] = {0x00, 0x03, 0x00, 0x03, 0x00, 0};
-const uint8_t NUMBER[] = {0x14, 0x7F, 0x14, 0x7F, 0x14, 0};
-const uint8_t DOLLAR[] = {0x26, 0x49, 0x7F, 0x49, 0x32, 0};
-const uint8_t PERCENT[] = {0x22, 0x15, 0x2A, 0x54, 0x22, 0};
-const uint8_t AMP[] = {0x36, 0x49, 0x59, 0x26, 0x50, 0};
-const uint8_t APOSTROPHE[] = {0x00, 0x00, 0x03, 0x00, 0x00, 0};
-const uint8_t L_PAREN[] = {0x00, 0x1C, 0x22, 0x41, 0x00, 0};
-const uint8_t R_PAREN[] = {0x00, 0x41, 0x22, 0x1C, 0x00, 0};
-const uint8_t ASTERISK[] = {0x22, 0x14, 0x0E, 0x14, 0x22, 0};
-const uint8_t PLUS[] = {0x08, 0x08, 0x3E, 0x08, 0x08, 0};
-const uint8_t COMMA[] = {0x00, 0x40, 0x20, 0x00, 0x00, 0};
-const uint8_t HYPHEN[] = {0x00, 0x08, 0x08, 0x08, 0x00, 0};
-const uint8_t PERIOD[] = {0x00, 0x00, 0x40, 0x00, 0x00, 0};
-const uint8_t SLASH[] = {0x20, 0x10, 0x08, 0x04, 0x02, 0};
-const uint8_t ZERO[] = {0x3E, 0x41, 0x49, 0x41, 0x3E, 0};
-const uint8_t ONE[] = {0x00, 0x42, 0x7F, 0x40, 0x00, 0};
-const uint8_t TWO[] = {0x42, 0x61, 0x51, 0x49, 0x46, 0};
-const uint8_t THREE[] = {0x22, 0x49, 0x49, 0x49, 0x36, 0};
-const uint8_t FOUR[] = {0x0F, 0x08, 0x08, 0x7F, 0x08, 0};
-const uint8_t FIVE[] = {0x5F, 0x49, 0x49, 0x49, 0x31, 0};
-const uint8_t SIX[] = {0x3E, 0x49, 0x49, 0x49, 0x32, 0};
-const uint8_t SEVEN[] = {0x01, 0x01, 0x71, 0x0D, 0x03, 0};
-const uint8_t EIGHT[] = {0x36, 0x49, 0x49, 0x49, 0x36, 0};
-const uint8_t NINE[] = {0x06, 0x09, 0x49, 0x29, 0x1E, 0};
-const uint8_t COLON[] = {0x00, 0x36, 0x36, 0x00, 0x00, 0};
-const uint8_t SEMICOLON[] = {0x00, 0x36, 0x16, 0x00, 0x00, 0};
-const uint8_t LESS_THAN[] = {0x08, 0x14, 0x14, 0x22, 0x22, 0};
-const uint8_t EQUALS[] = {0x14, 0x14, 0x14, 0x14, 0x14, 0};
-const uint8_t GREATER_THAN[] = {0x22, 0x22, 0x14, 0x14, 0x08, 0};
-const uint8_t QUESTION[] = {0x02, 0x01, 0x51, 0x09, 0x06, 0};
-const uint8_t AT[] = {0x3E, 0x49, 0x55, 0x7D, 0x3E, 0};
-const uint8_t A_UP[] = {0x7E, 0x09, 0x09, 0x09, 0x7E, 0};
-const uint8_t B_UP[] = {0x7F, 0x49, 0x49, 0x49, 0x36, 0};
-const uint8_t C_UP[] = {0x3E, 0x41, 0x41, 0x41, 0x22, 0};
-const uint8_t D_UP[] = {0x7F, 0x41, 0x41, 0x42, 0x3C, 0};
-const uint8_t E_UP[] = {0x7F, 0x49, 0x49, 0x41, 0x41, 0};
-const uint8_t F_UP[] = {0x7F, 0x09, 0x09, 0x01, 0x01, 0};
-const uint8_t G_UP[] = {0x3E, 0x41, 0x49, 0x49, 0x32, 0};
-const uint8_t H_UP[] = {0x7F, 0x08, 0x08, 0x08, 0x7F, 0};
-const uint8_t I_UP[] = {0x41, 0x41, 0x7F, 0x41, 0x41, 0};
-const uint8_t J_UP[] = {0x20, 0x40, 0x40, 0x3F, 0x00, 0};
-const uint8_t K_UP[] = {0x7F, 0x08, 0x14, 0x22, 0x41, 0};
-const uint8_t L_UP[] = {0x7F, 0x40 ,0x40, 0x40, 0x00, 0};
-const uint8_t M_UP[] = {0x7F, 0x02, 0x04, 0x02, 0x7F, 0};
-const uint8_t N_UP[] = {0x7F, 0x06, 0x08, 0x30, 0x7F, 0};
-const uint8_t O_UP[] = {0x3E, 0x41, 0x41, 0x41, 0x3E, 0};
-const uint8_t P_UP[] = {0x7F, 0x09, 0x09, 0x09, 0x06, 0};
-const uint8_t Q_UP[] = {0x3E, 0x41, 0x41, 0x21, 0x5E, 0};
-const uint8_t R_UP[] = {0x7F, 0x09, 0x19, 0x69, 0x06, 0};
-const uint8_t S_UP[] = {0x26, 0x49, 0x49, 0x49, 0x32, 0};
-const uint8_t T_UP[] = {0x01, 0x01, 0x7F, 0x01, 0x01, 0};
-const uint8_t U_UP[] = {0x3F, 0x40, 0x40, 0x40, 0x3F, 0};
-const uint8_t V_UP[] = {0x07, 0x18, 0x60, 0x18, 0x07, 0};
-const uint8_t W_UP[] = {0x3F, 0x40, 0x30, 0x40, 0x3F, 0};
-const uint8_t X_UP[] = {0x63, 0x14, 0x08, 0x14, 0x63, 0};
-const uint8_t Y_UP[] = {0x03, 0x04, 0x78, 0x04, 0x03, 0};
-const uint8_t Z_UP[] = {0x61, 0x51, 0x49, 0x45, 0x43, 0};
-const uint8_t L_BRACKET[] = {0x00, 0x7F, 0x41, 0x41, 0x00, 0};
-const uint8_t BACKSLASH[] = {0x02, 0x04, 0x08, 0x10, 0x20, 0};
-const uint8_t R_BRACKET[] = {0x00, 0x41, 0x41, 0x7F, 0x00, 0};
-const uint8_t CARET[] = {0x00, 0x02, 0x01, 0x02, 0x00, 0};
-const uint8_t UNDERSCORE[] = {0x40, 0x40, 0x40, 0x40, 0x40, 0};
-const uint8_t GRAVE[] = {0x00, 0x01, 0x02, 0x00, 0x00, 0};
-const uint8_t A_LO[] = {0x38, 0x44, 0x44, 0x28, 0x7C, 0};
-const uint8_t B_LO[] = {0x7F, 0x28, 0x44, 0x44, 0x38, 0};
-const uint8_t C_LO[] = {0x38, 0x44, 0x44, 0x28, 0x00, 0};
-const uint8_t D_LO[] = {0x38, 0x44, 0x44, 0x28, 0x7F, 0};
-const uint8_t E_LO[] = {0x38, 0x54, 0x54, 0x18, 0x00, 0};
-const uint8_t F_LO[] = {0x08, 0x7E, 0x09, 0x02, 0x00, 0};
-const uint8_t G_LO[] = {0x2C, 0x52, 0x52, 0x3C, 0x00, 0};
-const uint8_t H_LO[] = {0x7F, 0x10, 0x08, 0x70, 0x00, 0};
-const uint8_t I_LO[] = {0x00, 0x00, 0x7A, 0x00, 0x00, 0};
-const uint8_t J_LO[] = {0x20, 0x40, 0x40, 0x3A, 0x00, 0};
-const uint8_t K_LO[] = {0x7E, 0x10, 0x28, 0x40, 0x00, 0};
-const uint8_t L_LO[] = {0x00, 0x00, 0x7E, 0x00, 0x00, 0};
-const uint8_t M_LO[] = {0x78, 0x08, 0x30, 0x08, 0x70, 0};
-const uint8_t N_LO[] = {0x78, 0x08, 0x08, 0x70, 0x00, 0};
-const uint8_t O_LO[] = {0x00, 0x30, 0x48, 0x48, 0x30, 0};
-const uint8_t P_LO[] = {0x00, 0x78, 0x14, 0x14, 0x08, 0};
-const uint8_t Q_LO[] = {0x08, 0x14, 0x14, 0x78, 0x00, 0};
-const uint8_t R_LO[] = {0x78, 0x04, 0x04, 0x08, 0x00, 0};
-const uint8_t S_LO[] = {0x08, 0x54, 0x54, 0x20, 0x00, 0};
-const uint8_t T_LO[] = {0x08, 0x3C, 0x48, 0x00, 0x00, 0};
-const uint8_t U_LO[] = {0x38, 0x40, 0x40, 0x38, 0x00, 0};
-const uint8_t V_LO[] = {0x0C, 0x30, 0x40, 0x30, 0x0C, 0};
-const uint8_t W_LO[] = {0x38, 0x40, 0x20, 0x40, 0x38, 0};
-const uint8_t X_LO[] = {0x44, 0x28, 0x10, 0x28, 0x44, 0};
-const uint8_t Y_LO[] = {0x44, 0x28, 0x10, 0x08, 0x04, 0};
-const uint8_t Z_LO[] = {0x44, 0x64, 0x54, 0x4C, 0x44, 0};
-const uint8_t L_BRACE[] = {0x00, 0x08, 0x36, 0x41, 0x00, 0};
-const uint8_t PIPE[] = {0x00, 0x00, 0x7F, 0x00, 0x00, 0};
-const uint8_t R_BRACE[] = {0x00, 0x41, 0x36, 0x08, 0x00, 0};
-const uint8_t TILDE[] = {0x04, 0x04, 0x08, 0x08, 0x04, 0};
-
-// An array of the above characters, in ASCII order. By subtracting away the
-// non-printable character range, this can be used to draw strings.
-const uint8_t * charEncoding[] = {
-    SPACE, BANG, QUOTE, NUMBER, DOLLAR, PERCENT, AMP, APOSTROPHE, L_PAREN,
-    R_PAREN, ASTERISK, PLUS, COMMA, HYPHEN, PERIOD, SLASH, ZERO, ONE, TWO,
-    THREE, FOUR, FIVE, SIX, SEVEN, EIGHT, NINE, COLON, SEMICOLON, LESS_THAN,
-    EQUALS, GREATER_THAN, QUESTION, AT, A_UP, B_UP, C_UP, D_UP, E_UP, F_UP,
-    G_UP, H_UP, I_UP, J_UP, K_UP, L_UP, M_UP, N_UP, O_UP, P_UP, Q_UP, R_UP,
-    S_UP, T_UP, U_UP, V_UP, W_UP, X_UP, Y_UP, Z_UP, L_BRACKET, BACKSLASH,
-    R_BRACKET, CARET, UNDERSCORE, GRAVE, A_LO, B_LO, C_LO, D_LO, E_LO, F_LO,
-    G_LO, H_LO, I_LO, J_LO, K_LO, L_LO, M_LO, N_LO, O_LO, P_LO, Q_LO, R_LO,
-    S_LO, T_LO, U_LO, V_LO, W_LO, X_LO, Y_LO, Z_LO, L_BRACE, PIPE, R_BRACE,
-    TILDE
+#define GLYPH_WIDTH 5
+#define GLYPH_COUNT 95
+
+// Every printable ASCII character in order, as its name and five columns of
+// pixel data. Each glyph is followed by a blank column when drawn.
+#define GLYPHS(G) \
+    G(SPACE, 0x00, 0x00, 0x00, 0x00, 0x00) \
+    G(BANG, 0x00, 0x00, 0x4F, 0x00, 0x00) \
+    G(QUOTE, 0x00, 0x03, 0x00, 0x03, 0x00) \
+    G(NUMBER, 0x14, 0x7F, 0x14, 0x7F, 0x14) \
+    G(DOLLAR, 0x26, 0x49, 0x7F, 0x49, 0x32) \
+    G(PERCENT, 0x22, 0x15, 0x2A, 0x54, 0x22) \
+    G(AMP, 0x36, 0x49, 0x59, 0x26, 0x50) \
+    G(APOSTROPHE, 0x00, 0x00, 0x03, 0x00, 0x00) \
+    G(L_PAREN, 0x00, 0x1C, 0x22, 0x41, 0x00) \
+    G(R_PAREN, 0x00, 0x41, 0x22, 0x1C, 0x00) \
+    G(ASTERISK, 0x22, 0x14, 0x0E, 0x14, 0x22) \
+    G(PLUS, 0x08, 0x08, 0x3E, 0x08, 0x08) \
+    G(COMMA, 0x00, 0x40, 0x20, 0x00, 0x00) \
+    G(HYPHEN, 0x00, 0x08, 0x08, 0x08, 0x00) \
+    G(PERIOD, 0x00, 0x00, 0x40, 0x00, 0x00) \
+    G(SLASH, 0x20, 0x10, 0x08, 0x04, 0x02) \
+    G(ZERO, 0x3E, 0x41, 0x49, 0x41, 0x3E) \
+    G(ONE, 0x00, 0x42, 0x7F, 0x40, 0x00) \
+    G(TWO, 0x42, 0x61, 0x51, 0x49, 0x46) \
+    G(THREE, 0x22, 0x49, 0x49, 0x49, 0x36) \
+    G(FOUR, 0x0F, 0x08, 0x08, 0x7F, 0x08) \
+    G(FIVE, 0x5F, 0x49, 0x49, 0x49, 0x31) \
+    G(SIX, 0x3E, 0x49, 0x49, 0x49, 0x32) \
+    G(SEVEN, 0x01, 0x01, 0x71, 0x0D, 0x03) \
+    G(EIGHT, 0x36, 0x49, 0x49, 0x49, 0x36) \
+    G(NINE, 0x06, 0x09, 0x49, 0x29, 0x1E) \
+    G(COLON, 0x00, 0x36, 0x36, 0x00, 0x00) \
+    G(SEMICOLON, 0x00, 0x36, 0x16, 0x00, 0x00) \
+    G(LESS_THAN, 0x08, 0x14, 0x14, 0x22, 0x22) \
+    G(EQUALS, 0x14, 0x14, 0x14, 0x14, 0x14) \
+    G(GREATER_THAN, 0x22, 0x22, 0x14, 0x14, 0x08) \
+    G(QUESTION, 0x02, 0x01, 0x51, 0x09, 0x06) \
+    G(AT, 0x3E, 0x49, 0x55, 0x7D, 0x3E) \
+    G(A_UP, 0x7E, 0x09, 0x09, 0x09, 0x7E) \
+    G(B_UP, 0x7F, 0x49, 0x49, 0x49, 0x36) \
+    G(C_UP, 0x3E, 0x41, 0x41, 0x41, 0x22) \
+    G(D_UP, 0x7F, 0x41, 0x41, 0x42, 0x3C) \
+    G(E_UP, 0x7F, 0x49, 0x49, 0x41, 0x41) \
+    G(F_UP, 0x7F, 0x09, 0x09, 0x01, 0x01) \
+    G(G_UP, 0x3E, 0x41, 0x49, 0x49, 0x32) \
+    G(H_UP, 0x7F, 0x08, 0x08, 0x08, 0x7F) \
+    G(I_UP, 0x41, 0x41, 0x7F, 0x41, 0x41) \
+    G(J_UP, 0x20, 0x40, 0x40, 0x3F, 0x00) \
+    G(K_UP, 0x7F, 0x08, 0x14, 0x22, 0x41) \
+    G(L_UP, 0x7F, 0x40, 0x40, 0x40, 0x00) \
+    G(M_UP, 0x7F, 0x02, 0x04, 0x02, 0x7F) \
+    G(N_UP, 0x7F, 0x06, 0x08, 0x30, 0x7F) \
+    G(O_UP, 0x3E, 0x41, 0x41, 0x41, 0x3E) \
+    G(P_UP, 0x7F, 0x09, 0x09, 0x09, 0x06) \
+    G(Q_UP, 0x3E, 0x41, 0x41, 0x21, 0x5E) \
+    G(R_UP, 0x7F, 0x09, 0x19, 0x69, 0x06) \
+    G(S_UP, 0x26, 0x49, 0x49, 0x49, 0x32) \
+    G(T_UP, 0x01, 0x01, 0x7F, 0x01, 0x01) \
+    G(U_UP, 0x3F, 0x40, 0x40, 0x40, 0x3F) \
+    G(V_UP, 0x07, 0x18, 0x60, 0x18, 0x07) \
+    G(W_UP, 0x3F, 0x40, 0x30, 0x40, 0x3F) \
+    G(X_UP, 0x63, 0x14, 0x08, 0x14, 0x63) \
+    G(Y_UP, 0x03, 0x04, 0x78, 0x04, 0x03) \
+    G(Z_UP, 0x61, 0x51, 0x49, 0x45, 0x43) \
+    G(L_BRACKET, 0x00, 0x7F, 0x41, 0x41, 0x00) \
+    G(BACKSLASH, 0x02, 0x04, 0x08, 0x10, 0x20) \
+    G(R_BRACKET, 0x00, 0x41, 0x41, 0x7F, 0x00) \
+    G(CARET, 0x00, 0x02, 0x01, 0x02, 0x00) \
+    G(UNDERSCORE, 0x40, 0x40, 0x40, 0x40, 0x40) \
+    G(GRAVE, 0x00, 0x01, 0x02, 0x00, 0x00) \
+    G(A_LO, 0x38, 0x44, 0x44, 0x28, 0x7C) \
+    G(B_LO, 0x7F, 0x28, 0x44, 0x44, 0x38) \
+    G(C_LO, 0x38, 0x44, 0x44, 0x28, 0x00) \
+    G(D_LO, 0x38, 0x44, 0x44, 0x28, 0x7F) \
+    G(E_LO, 0x38, 0x54, 0x54, 0x18, 0x00) \
+    G(F_LO, 0x08, 0x7E, 0x09, 0x02, 0x00) \
+    G(G_LO, 0x2C, 0x52, 0x52, 0x3C, 0x00) \
+    G(H_LO, 0x7F, 0x10, 0x08, 0x70, 0x00) \
+    G(I_LO, 0x00, 0x00, 0x7A, 0x00, 0x00) \
+    G(J_LO, 0x20, 0x40, 0x40, 0x3A, 0x00) \
+    G(K_LO, 0x7E, 0x10, 0x28, 0x40, 0x00) \
+    G(L_LO, 0x00, 0x00, 0x7E, 0x00, 0x00) \
+    G(M_LO, 0x78, 0x08, 0x30, 0x08, 0x70) \
+    G(N_LO, 0x78, 0x08, 0x08, 0x70, 0x00) \
+    G(O_LO, 0x00, 0x30, 0x48, 0x48, 0x30) \
+    G(P_LO, 0x00, 0x78, 0x14, 0x14, 0x08) \
+    G(Q_LO, 0x08, 0x14, 0x14, 0x78, 0x00) \
+    G(R_LO, 0x78, 0x04, 0x04, 0x08, 0x00) \
+    G(S_LO, 0x08, 0x54, 0x54, 0x20, 0x00) \
+    G(T_LO, 0x08, 0x3C, 0x48, 0x00, 0x00) \
+    G(U_LO, 0x38, 0x40, 0x40, 0x38, 0x00) \
+    G(V_LO, 0x0C, 0x30, 0x40, 0x30, 0x0C) \
+    G(W_LO, 0x38, 0x40, 0x20, 0x40, 0x38) \
+    G(X_LO, 0x44, 0x28, 0x10, 0x28, 0x44) \
+    G(Y_LO, 0x44, 0x28, 0x10, 0x08, 0x04) \
+    G(Z_LO, 0x44, 0x64, 0x54, 0x4C, 0x44) \
+    G(L_BRACE, 0x00, 0x08, 0x36, 0x41, 0x00) \
+    G(PIPE, 0x00, 0x00, 0x7F, 0x00, 0x00) \
+    G(R_BRACE, 0x00, 0x41, 0x36, 0x08, 0x00) \
+    G(TILDE, 0x04, 0x04, 0x08, 0x08, 0x04)
+
+// Named copies of each glyph, with the blank column included, for drawing
+// single characters with the region functions. These live in RAM, so any
+// not referenced by the application should be left to the linker to discard.
+#define NAMED_GLYPH(name, a, b, c, d, e) const uint8_t name[] = {a, b, c, d, e, 0};
+GLYPHS(NAMED_GLYPH)
+
+// The table drawText uses, kept in flash and indexed by c - ' '.
+#define TABLE_GLYPH(name, a, b, c, d, e) {a, b, c, d, e},
+static const uint8_t glyphs[GLYPH_COUNT][GLYPH_WIDTH] PROGMEM = {
+    GLYPHS(TABLE_GLYPH)
 };
 
-int drawText(uint8_t x, uint8_t y, const char * str, uint8_t opaque) {
-    uint8_t curChar;
+int drawText(uint8_t x, uint8_t y, const char * str, uint8_t op) {
+    uint8_t columns[NOKIA_STRIP_WIDTH], width = 0, drawn = 0, column,
+            screen = screenWidth();
+    const uint8_t * glyph;
+
+    if(x >= screen || y > screenHeight() - 8) return 0;
+
+    // Gather the columns of every character that fits (each followed by a
+    // blank one), so the whole string goes out as a single region
+    for(; *str != 0 && x + width < screen; str++) {
+        column = (uint8_t)(*str - ' ');
+        glyph = glyphs[column < GLYPH_COUNT ? column : '?' - ' '];
+        for(column = 0; column <= GLYPH_WIDTH && x + width < screen;
+                column++) {
+            if(width - drawn == NOKIA_STRIP_WIDTH) {
+                drawRegionColumns(x + drawn, y, width - drawn, 8, columns, 1,
+                        op);
+                drawn = width;
+            }
+            columns[width++ - drawn] = column < GLYPH_WIDTH ?
+                    pgm_read_byte(glyph + column) : 0;
+        }
+    }
+
+    return drawRegionColumns(x + drawn, y, width - drawn, 8, columns, 1, op);
+}
+
+// The same glyphs as a font, for drawing them scaled. The bottom row of every
+// glyph is blank, so it is only 7 pixels tall.
+const struct nokiaFont FONT_5X7 = {
+    glyphs[0], 0, 0, ' ', GLYPH_COUNT, GLYPH_WIDTH, 7, 1
+};
 
-    while((curChar = *str) != 0) {
-        curChar -= 0x20;
-        if(curChar <= 0x5E)
-            drawRegionRows(x, y, 6, 8, charEncoding[curChar], 1, opaque);
-        else
-            drawRegionRows(x, y, 6, 8, QUESTION, 1, opaque);
+/*
+ * Helper function to find the glyph for a character, returning its width and
+ * pointing bitmap at its first column. A character the font doesn't have is
+ * drawn as '?' if it has that, or else skipped.
+ */
+static uint8_t findGlyph(const struct nokiaFont * font, char c,
+        const uint8_t ** bitmap) {
+    uint8_t index = (uint8_t)(c - font->first);
 
-	x += 6;
-        if(x == LCD_WIDTH) break;
-	++str;
+    if(index >= font->count) {
+        index = (uint8_t)('?' - font->first);
+        if(index >= font->count) return 0;
     }
 
-    return 1;
+    if(font->widths) {
+        *bitmap = font->bitmap + pgm_read_word(font->offsets + index);
+        return pgm_read_byte(font->widths + index);
+    }
+    *bitmap = font->bitmap + index * font->width * ((font->height + 7) >> 3);
+    return font->width;
 }
 
+/*
+ * Helper function to get the 8 pixels of a scaled glyph column starting at
+ * row, as a column byte. Each source pixel covers scale rows.
+ */
+static uint8_t scaledByte(const uint8_t * column, uint8_t row, uint8_t height,
+        uint8_t scale) {
+    uint8_t byte = 0, bit, source = row / scale, left = scale - row % scale;
+
+    if(scale == 1) return pgm_read_byte(column + (row >> 3));
+
+    for(bit = 0; bit < 8 && source < height; bit++) {
+        if(pgm_read_byte(column + (source >> 3)) & (1 << (source & 7)))
+            byte |= 1 << bit;
+        if(--left == 0) {
+            source++;
+            left = scale;
+        }
+    }
+
+    return byte;
+}
+
+uint16_t measureText(const char * str, const struct nokiaFont * font,
+        uint8_t scale) {
+    const uint8_t * bitmap;
+    uint16_t width = 0;
+
+    for(; *str != 0; str++)
+        width += (findGlyph(font, *str, &bitmap) + font->spacing) * scale;
+
+    return width;
+}
+
+int drawFontText(uint8_t x, uint8_t y, const char * str,
+        const struct nokiaFont * font, uint8_t scale, uint8_t op) {
+    uint8_t strip[NOKIA_STRIP_WIDTH], bytes = (font->height + 7) >> 3, width,
+            height, row, rows, curX, drawn, column, glyphWidth, repeat, byte,
+            screen = screenWidth();
+    uint16_t fullWidth;
+    const uint8_t * bitmap = 0;
+    const char * c;
+
+    if(scale == 0 || x >= screen || y >= screenHeight() ||
+            font->height * scale > screenHeight() - y || op > ROP_INVERT)
+        return 0;
+
+    // The string is cut off at the right edge of the screen
+    fullWidth = measureText(str, font, scale);
+    width = fullWidth < screen - x ? fullWidth : screen - x;
+    height = font->height * scale;
+    if(!beginFrame()) return 0;
+
+    // Gather one 8 pixel strip of the whole string at a time, so each bank is
+    // drawn in one pass, and sent once when the frame ends
+    for(row = 0; row < height; row += 8) {
+        rows = height - row > 8 ? 8 : height - row;
+        curX = drawn = 0;
+        for(c = str; *c != 0 && curX < width; c++) {
+            glyphWidth = findGlyph(font, *c, &bitmap);
+            for(column = 0; column < glyphWidth + font->spacing; column++) {
+                byte = column < glyphWidth ? scaledByte(bitmap + column*bytes,
+                        row, font->height, scale) : 0;
+                for(repeat = 0; repeat < scale && curX < width; repeat++) {
+                    if(curX - drawn == NOKIA_STRIP_WIDTH) {
+                        drawRegionColumns(x + drawn, y + row, curX - drawn,
+                                rows, strip, 1, op);
+                        drawn = curX;
+                    }
+                    strip[curX++ - drawn] = byte;
+                }
+            }
+        }
+        drawRegionColumns(x + drawn, y + row, width - drawn, rows, strip, 1,
+                op);
+    }
+
+    return endFrame();
+}
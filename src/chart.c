@@ -0,0 +1,125 @@
+#include "libnokiadisplay.h"
+
+#ifndef NOKIA_BANDED
+
+/*
+ * Helper function to scale a sample to a row of the chart, counted from the
+ * top.
+ */
+static uint8_t sampleRow(const struct nokiaChart * chart, int16_t value) {
+    int32_t range = (int32_t)chart->maximum - chart->minimum;
+
+    if(value <= chart->minimum) return chart->height - 1;
+    if(value >= chart->maximum) return 0;
+
+    return chart->height - 1 -
+            ((int32_t)value - chart->minimum) * (chart->height - 1) / range;
+}
+
+/*
+ * Helper function to get the span of rows a column covers, given its sample
+ * and the one in the column to its left. The span reaches towards the left
+ * sample without overlapping it, so the columns join up into a line. The
+ * leftmost column has nothing to join to, and is always a single point.
+ */
+static void columnSpan(uint8_t row, uint8_t left, uint8_t first,
+        uint8_t * top, uint8_t * bottom) {
+    *top = *bottom = row;
+    if(first) return;
+
+    if(left > row + 1) *bottom = left - 1;
+    else if(left + 1 < row) *top = left + 1;
+}
+
+/*
+ * Helper function to get the sample in a column, counted from the oldest.
+ */
+static inline uint8_t sampleAt(const struct nokiaChart * chart, uint8_t i) {
+    i += chart->head;
+    return chart->rows[i < chart->width ? i : i - chart->width];
+}
+
+/*
+ * Helper function to draw a column's span.
+ */
+static void drawColumn(const struct nokiaChart * chart, uint8_t column,
+        uint8_t top, uint8_t bottom, uint8_t state) {
+    fillRect(chart->x + column, chart->y + top, 1, bottom - top + 1, state);
+}
+
+int initChart(struct nokiaChart * chart, uint8_t x, uint8_t y, uint8_t width,
+        uint8_t height, int16_t minimum, int16_t maximum, uint8_t bulk) {
+    if(width == 0 || height == 0 || maximum <= minimum ||
+            !fillRect(x, y, width, height, 0)) return 0;
+
+    chart->x = x;
+    chart->y = y;
+    chart->width = width;
+    chart->height = height;
+    chart->minimum = minimum;
+    chart->maximum = maximum;
+    chart->bulk = bulk;
+    chart->head = chart->count = 0;
+
+    return 1;
+}
+
+int addChartSample(struct nokiaChart * chart, int16_t value) {
+    uint8_t row = sampleRow(chart, value), column, oldTop, oldBottom, top,
+            bottom, previous, next;
+
+    if(!beginFrame()) return 0;
+
+    // Until the region is full, samples are simply added on the right
+    if(chart->count < chart->width) {
+        column = chart->count++;
+        chart->rows[column] = row;
+        columnSpan(row, column ? chart->rows[column - 1] : 0, column == 0,
+                &top, &bottom);
+        drawColumn(chart, column, top, bottom, 1);
+        return endFrame();
+    }
+
+    if(chart->bulk) {
+        scrollLeft(chart->x, chart->y, chart->width, chart->height, 1);
+        // The new leftmost column still reaches towards the sample that
+        // scrolled off, and has to become a single point
+        if(chart->width > 1) {
+            columnSpan(sampleAt(chart, 1), sampleAt(chart, 0), 0, &oldTop,
+                    &oldBottom);
+            drawColumn(chart, 0, oldTop, oldBottom, 0);
+            columnSpan(sampleAt(chart, 1), 0, 1, &top, &bottom);
+            drawColumn(chart, 0, top, bottom, 1);
+        }
+    } else {
+        // Every column moves one to the left; only redraw those whose span
+        // actually changes
+        previous = sampleAt(chart, 0);
+        for(column = 0; column < chart->width; column++) {
+            next = column + 1 < chart->width ?
+                    sampleAt(chart, column + 1) : row;
+            columnSpan(sampleAt(chart, column), previous, column == 0, &oldTop,
+                    &oldBottom);
+            columnSpan(next, sampleAt(chart, column), column == 0, &top,
+                    &bottom);
+            previous = sampleAt(chart, column);
+            if(top == oldTop && bottom == oldBottom) continue;
+
+            drawColumn(chart, column, oldTop, oldBottom, 0);
+            drawColumn(chart, column, top, bottom, 1);
+        }
+    }
+
+    // The newest sample replaces the oldest in the ring
+    chart->rows[chart->head] = row;
+    if(++chart->head == chart->width) chart->head = 0;
+
+    if(chart->bulk) {
+        previous = chart->width > 1 ? sampleAt(chart, chart->width - 2) : 0;
+        columnSpan(row, previous, chart->width == 1, &top, &bottom);
+        drawColumn(chart, chart->width - 1, top, bottom, 1);
+    }
+
+    return endFrame();
+}
+#endif
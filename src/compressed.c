@@ -0,0 +1,43 @@
+#include "libnokiadisplay.h"
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#endif
+
+int drawCompressedRegion(uint8_t x, uint8_t y, const uint8_t * data,
+        uint8_t op) {
+    uint8_t strip[NOKIA_STRIP_WIDTH], width, height, row, rows, i, drawn;
+    uint8_t count = 0, repeat = 0, value = 0;
+
+    width = pgm_read_byte(data++);
+    height = pgm_read_byte(data++);
+    if(x >= screenWidth() || y >= screenHeight() || x + width > screenWidth() ||
+            y + height > screenHeight() || op > ROP_INVERT) return 0;
+    if(!beginFrame()) return 0;
+
+    // Decode one 8 pixel tall strip at a time and draw it straight away,
+    // inside a frame so that everything is still sent once at the end
+    for(row = 0; row < height; row += 8) {
+        rows = height - row > 8 ? 8 : height - row;
+        for(i = drawn = 0; i < width; i++) {
+            if(i - drawn == NOKIA_STRIP_WIDTH) {
+                drawRegionColumns(x + drawn, y + row, i - drawn, rows, strip,
+                        1, op);
+                drawn = i;
+            }
+            if(count == 0) {
+                value = pgm_read_byte(data++);
+                repeat = value & 0x80;
+                count = repeat ? (value & 0x7F) + 2 : value + 1;
+                if(repeat) value = pgm_read_byte(data++);
+            }
+            strip[i - drawn] = repeat ? value : pgm_read_byte(data++);
+            count--;
+        }
+        drawRegionColumns(x + drawn, y + row, width - drawn, rows, strip, 1,
+                op);
+    }
+
+    return endFrame();
+}
@@ -0,0 +1,113 @@
+#include "libnokiadisplay.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef NOKIA_BANDED
+
+#define CELL_WIDTH 6
+#define CELL_HEIGHT 8
+
+/*
+ * Helper function to blank the screen and every cell.
+ */
+static int blank(struct nokiaConsole * console) {
+    memset(console->cells, ' ', sizeof(console->cells));
+    console->column = console->row = 0;
+
+    return fillRect(0, 0, screenWidth(), screenHeight(), 0);
+}
+
+/*
+ * Helper function to move the cursor to the start of the next row, scrolling
+ * everything up if it is on the last one.
+ */
+static void newLine(struct nokiaConsole * console) {
+    uint8_t columns = console->columns;
+
+    console->column = 0;
+    if(console->row < console->rows - 1) {
+        console->row++;
+        return;
+    }
+
+    // A row is exactly one bank, so the cells move with it
+    scrollUp(1);
+    memmove(console->cells, console->cells + columns,
+            (console->rows - 1) * columns);
+    memset(console->cells + (console->rows - 1) * columns, ' ', columns);
+}
+
+/*
+ * Helper function to write a character at the cursor and move it along. The
+ * character is only drawn if its cell doesn't already show it.
+ */
+static void putChar(struct nokiaConsole * console, char c) {
+    char str[2] = {c, 0};
+    char * cell;
+
+    // Wrapping waits until there is something to write on the next row, so a
+    // full row followed by '\n' doesn't leave a blank one
+    if(console->column == console->columns) newLine(console);
+
+    if(c < ' ' || c > '~') c = str[0] = '?';
+    cell = console->cells + console->row*console->columns + console->column;
+    if(*cell != c) {
+        *cell = c;
+        drawText(console->column*CELL_WIDTH, console->row*CELL_HEIGHT, str,
+                ROP_COPY);
+    }
+    console->column++;
+}
+
+int consoleInit(struct nokiaConsole * console) {
+    // Sized for the screen as it is now, in case it has been rotated
+    console->columns = screenWidth() / CELL_WIDTH;
+    console->rows = screenHeight() / CELL_HEIGHT;
+
+    return blank(console);
+}
+
+int consoleSetCursor(struct nokiaConsole * console, uint8_t column,
+        uint8_t row) {
+    if(column >= console->columns || row >= console->rows) return 0;
+
+    console->column = column;
+    console->row = row;
+
+    return 1;
+}
+
+int consoleWrite(struct nokiaConsole * console, const char * str) {
+    if(!beginFrame()) return 0;
+
+    for(; *str != 0; str++) {
+        switch(*str) {
+            case '\n':
+                newLine(console);
+                break;
+            case '\r':
+                console->column = 0;
+                break;
+            case '\f':
+                blank(console);
+                break;
+            default:
+                putChar(console, *str);
+        }
+    }
+
+    return endFrame();
+}
+
+int consolePrintf(struct nokiaConsole * console, const char * format, ...) {
+    char str[CONSOLE_COLUMNS * CONSOLE_ROWS + 1];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(str, sizeof(str), format, args);
+    va_end(args);
+
+    return consoleWrite(console, str);
+}
+#endif
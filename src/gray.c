@@ -0,0 +1,62 @@
+#include "libnokiadisplay.h"
+
+// Gray planes are layers
+#ifdef NOKIA_LAYERS
+
+// The high bit plane is shown for two subframes out of three and the low one
+// for the third, so a pixel is on for as many subframes as its level
+#define PHASE_LOW 1
+#define PHASES 3
+
+int initGray(struct nokiaGray * gray) {
+    initLayer(&gray->low, ROP_COPY);
+    initLayer(&gray->high, ROP_COPY);
+    gray->stack[0] = &gray->low;
+    gray->stack[1] = &gray->high;
+    gray->phase = 0;
+
+    return setLayers(gray->stack, 2);
+}
+
+int setGrayPixel(struct nokiaGray * gray, uint8_t x, uint8_t y,
+        uint8_t level) {
+    uint8_t result;
+
+    if(level >= GRAY_LEVELS || !beginFrame()) return 0;
+
+    useLayer(&gray->high);
+    result = drawPixel(x, y, level >> 1);
+    useLayer(&gray->low);
+    result &= drawPixel(x, y, level & 1);
+    useLayer(0);
+
+    return endFrame() && result;
+}
+
+int fillGrayRect(struct nokiaGray * gray, uint8_t x, uint8_t y,
+        uint8_t width, uint8_t height, uint8_t level) {
+    uint8_t result;
+
+    if(level >= GRAY_LEVELS || !beginFrame()) return 0;
+
+    useLayer(&gray->high);
+    result = fillRect(x, y, width, height, level >> 1);
+    useLayer(&gray->low);
+    result &= fillRect(x, y, width, height, level & 1);
+    useLayer(0);
+
+    return endFrame() && result;
+}
+
+int grayTick(struct nokiaGray * gray) {
+    if(!beginFrame()) return 0;
+
+    // The high plane covers the low one, so hiding and showing it swaps
+    // them, merging and sending only the bytes where they differ, and
+    // nothing at all between two high subframes
+    gray->phase = gray->phase + 1 == PHASES ? 0 : gray->phase + 1;
+    showLayer(&gray->high, gray->phase != PHASE_LOW);
+
+    return endFrame();
+}
+#endif
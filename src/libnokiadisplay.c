@@ -1,5 +1,18 @@
 #include "libnokiadisplay.h"
+#include <string.h>
+#ifdef __AVR__
+#include <avr/io.h>
 #include <util/delay.h>
+#ifdef NOKIA_ASYNC
+#include <avr/interrupt.h>
+#endif
+#ifdef NOKIA_ROTATION
+#include <avr/pgmspace.h>
+#endif
+#elif defined(NOKIA_ROTATION)
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#endif
 
 #define CMD_NORMAL 0x20
 #define CMD_EXTENDED 0x21
@@ -12,38 +25,285 @@
 
 #define Y_HEIGHT 6
 #define BUFFER_SIZE 504
+// Bytes needed to move the address within a bank (a single CMD_X)
+#define READDRESS_COST 1
 
-static volatile uint8_t * resP, * enableP, * dataP, * clockP, * selP;
-static uint8_t resM, enableM, dataM, clockM, selM;
-static uint8_t initialized = 0, powerMode = 4, x = 0, y = 0, vertical = 0;
-static uint8_t buffer[BUFFER_SIZE];
+#ifdef NOKIA_ROTATION
+// Size of the buffer as drawn on, which is swapped when rotated by 90 degrees
+#define WIDTH (cur->width)
+#define HEIGHT (cur->height)
+#define BANKS (cur->banks)
+// How the buffer is turned into the controller's layout when sent
+#define TRANSFORM_TRANSPOSE 1
+#define TRANSFORM_FLIP_X 2
+#define TRANSFORM_FLIP_Y 4
+#else
+#define WIDTH LCD_WIDTH
+#define HEIGHT LCD_HEIGHT
+#define BANKS Y_HEIGHT
+#endif
+
+// Fastest serial clock the PCD8544 accepts (250ns minimum clock cycle)
+#ifndef NOKIA_SPI_MAX_HZ
+#define NOKIA_SPI_MAX_HZ 4000000
+#endif
+
+#ifdef SPDR
+// Smallest SPI clock divider that stays within the controller's limit
+#if F_CPU / 2 <= NOKIA_SPI_MAX_HZ
+#define SPI_CLOCK_BITS 0
+#define SPI_STATUS_BITS _BV(SPI2X)
+#elif F_CPU / 4 <= NOKIA_SPI_MAX_HZ
+#define SPI_CLOCK_BITS 0
+#define SPI_STATUS_BITS 0
+#elif F_CPU / 8 <= NOKIA_SPI_MAX_HZ
+#define SPI_CLOCK_BITS _BV(SPR0)
+#define SPI_STATUS_BITS _BV(SPI2X)
+#else
+#define SPI_CLOCK_BITS _BV(SPR0)
+#define SPI_STATUS_BITS 0
+#endif
+#endif
+
+#ifdef UDR0
+// The USART used by TRANSPORT_USART in master SPI mode, 0 by default
+#ifndef NOKIA_USART
+#define NOKIA_USART 0
+#endif
+#define USART_PASTE(prefix, n, suffix) prefix ## n ## suffix
+#define USART_NAME(prefix, n, suffix) USART_PASTE(prefix, n, suffix)
+#define USART(prefix, suffix) USART_NAME(prefix, NOKIA_USART, suffix)
+// Older single USART parts name the vector without a number
+#if defined(USART_TX_vect) && NOKIA_USART == 0
+#define USART_TX_VECT USART_TX_vect
+#else
+#define USART_TX_VECT USART(USART, _TX_vect)
+#endif
+// Baud rate register value for the fastest clock within the limit
+#define USART_UBRR ((F_CPU + 2*NOKIA_SPI_MAX_HZ - 1) / (2*NOKIA_SPI_MAX_HZ) - 1)
+#endif
+
+#ifdef NOKIA_STATIC_PINS
+// Constant addresses and masks let every pin write compile to sbi/cbi
+#define resP (&NOKIA_RES_PORT)
+#define enableP (&NOKIA_ENABLE_PORT)
+#define selP (&NOKIA_SELECTOR_PORT)
+#define dataP (&NOKIA_DATA_PORT)
+#define clockP (&NOKIA_CLOCK_PORT)
+#define resM (1 << NOKIA_RES_BIT)
+#define enableM (1 << NOKIA_ENABLE_BIT)
+#define selM (1 << NOKIA_SELECTOR_BIT)
+#define dataM (1 << NOKIA_DATA_BIT)
+#define clockM (1 << NOKIA_CLOCK_BIT)
+#else
+#define resP (cur->resPort)
+#define enableP (cur->enablePort)
+#define selP (cur->selPort)
+#define dataP (cur->dataPort)
+#define clockP (cur->clockPort)
+#define resM (cur->resMask)
+#define enableM (cur->enableMask)
+#define selM (cur->selMask)
+#define dataM (cur->dataMask)
+#define clockM (cur->clockMask)
+#endif
+// The display every function acts on, chosen with useDisplay()
+static struct nokiaDisplay defaultDisplay, * cur = &defaultDisplay;
+#ifdef NOKIA_TRANSPORT
+#define transport NOKIA_TRANSPORT
+#else
+static uint8_t transport = TRANSPORT_BITBANG;
+#endif
+static void (*customWrite)(uint8_t byte, uint8_t dc);
+#ifndef NOKIA_BANDED
+// Clock for frame pacing, advanced by frameTick()
+static volatile uint8_t frameTicks;
+#endif
+#ifdef NOKIA_ASYNC
+// Front buffer being streamed by flushInterrupt(), and the span of each bank
+// still left to send. The minimum doubles as the send position.
+static uint8_t txBuffer[BUFFER_SIZE];
+static uint8_t txMin[Y_HEIGHT], txMax[Y_HEIGHT];
+static uint8_t txBank;
+static struct nokiaDisplay * txDisplay;
+static volatile uint8_t txBusy = 0;
+#endif
+
+#ifdef NOKIA_EMULATOR
+// Host builds let an emulated controller watch every pin change
+void pcd8544PortWritten(void);
+#endif
 
 /*
- * Helper function to turn a bit on or off.
+ * Helper function to turn a bit on or off. Every pin change goes through here.
  */
 static inline void writeBit(volatile uint8_t * addr, uint8_t mask, uint8_t state) {
     if(state) *addr |= mask;
     else *addr &= ~mask;
+#ifdef NOKIA_EMULATOR
+    pcd8544PortWritten();
+#endif
 }
 
 /*
  * Helper function for keeping track of the current coordinates.
- * Coordinates are incremented based on the current addressing mode.
+ * The controller is always left in horizontal addressing mode.
  */
 static inline void incrementCoordinates() {
-    if(vertical && ++y == Y_HEIGHT) {
-        y = 0;
-        if(++x == LCD_WIDTH) x = 0;
-    } else if(!vertical && ++x == LCD_WIDTH) {
-        x = 0;
-        if(++y == Y_HEIGHT) y = 0;
+    if(++cur->x == LCD_WIDTH) {
+        cur->x = 0;
+        if(++cur->y == Y_HEIGHT) cur->y = 0;
     }
 }
 
+#ifdef NOKIA_BANDED
+// Bands are sent whole once drawn, so nothing needs tracking
+static inline void markDirty(uint8_t bank, uint8_t minX, uint8_t maxX) {
+}
+
+/*
+ * Helper function to get the start of a bank in the buffer, or null if it is
+ * outside the band being drawn.
+ */
+static inline uint8_t * bankRow(uint8_t bank) {
+    bank -= cur->bandFirst;
+    return bank < cur->bandBanks ? cur->buffer + bank*LCD_WIDTH : 0;
+}
+
+/*
+ * Helper function to check whether any of the rows y through y + height - 1
+ * are in the band being drawn.
+ */
+static inline uint8_t inBand(uint8_t y, uint8_t height) {
+    return (uint8_t)((y + height - 1) >> 3) >= cur->bandFirst &&
+            y >> 3 < cur->bandFirst + cur->bandBanks;
+}
+#else
+/*
+ * Helper functions for dirty region tracking. Columns minX through maxX
+ * (inclusive) of the controller's bank are marked as needing to be sent.
+ */
+static inline void markSpan(uint8_t bank, uint8_t minX, uint8_t maxX) {
+    if(minX < cur->dirtyMin[bank]) cur->dirtyMin[bank] = minX;
+    if(maxX > cur->dirtyMax[bank]) cur->dirtyMax[bank] = maxX;
+}
+
+#ifdef NOKIA_ROTATION
+/*
+ * Helper function to mark columns minX through maxX of a bank of the buffer
+ * dirty, as the part of the controller's ram they end up in once transformed.
+ */
+static void markBuffer(uint8_t bank, uint8_t minX, uint8_t maxX) {
+    uint8_t transform = cur->transform, first, last, t;
+
+    if(!(transform & TRANSFORM_TRANSPOSE)) {
+        if(transform & TRANSFORM_FLIP_X) {
+            t = minX;
+            minX = LCD_WIDTH - 1 - maxX;
+            maxX = LCD_WIDTH - 1 - t;
+        }
+        if(transform & TRANSFORM_FLIP_Y) bank = Y_HEIGHT - 1 - bank;
+        markSpan(bank, minX, maxX);
+        return;
+    }
+
+    // Columns of the buffer are rows of the controller, and the rows of the
+    // bank are its columns, running right to left unless flipped
+    first = bank << 3;
+    last = first + 7 < LCD_WIDTH ? first + 7 : LCD_WIDTH - 1;
+    if(!(transform & TRANSFORM_FLIP_X)) {
+        t = first;
+        first = LCD_WIDTH - 1 - last;
+        last = LCD_WIDTH - 1 - t;
+    }
+    if(transform & TRANSFORM_FLIP_Y) {
+        t = minX;
+        minX = LCD_HEIGHT - 1 - maxX;
+        maxX = LCD_HEIGHT - 1 - t;
+    }
+    for(bank = minX >> 3; bank <= maxX >> 3; bank++) markSpan(bank, first, last);
+}
+#else
+static inline void markBuffer(uint8_t bank, uint8_t minX, uint8_t maxX) {
+    markSpan(bank, minX, maxX);
+}
+#endif
+
+#ifdef NOKIA_LAYERS
+/*
+ * Helper function to mark columns minX through maxX of a bank of a layer as
+ * needing to be composited.
+ */
+static inline void markLayer(struct nokiaLayer * layer, uint8_t bank,
+        uint8_t minX, uint8_t maxX) {
+    if(minX < layer->dirtyMin[bank]) layer->dirtyMin[bank] = minX;
+    if(maxX > layer->dirtyMax[bank]) layer->dirtyMax[bank] = maxX;
+}
+
+/*
+ * Helper function to mark what was just drawn dirty, in the layer being drawn
+ * on if there is one.
+ */
+static inline void markDirty(uint8_t bank, uint8_t minX, uint8_t maxX) {
+    if(cur->target) markLayer(cur->target, bank, minX, maxX);
+    else markBuffer(bank, minX, maxX);
+}
+#else
+static inline void markDirty(uint8_t bank, uint8_t minX, uint8_t maxX) {
+    markBuffer(bank, minX, maxX);
+}
+#endif
+
+static inline void markClean(uint8_t bank) {
+    cur->dirtyMin[bank] = 0xFF;
+    cur->dirtyMax[bank] = 0;
+}
+
+static inline uint8_t * bankRow(uint8_t bank) {
+#ifdef NOKIA_LAYERS
+    if(cur->target) return cur->target->plane + bank*WIDTH;
+#endif
+    return cur->buffer + bank*WIDTH;
+}
+
+static inline uint8_t inBand(uint8_t y, uint8_t height) {
+    return 1;
+}
+#endif
+
+/*
+ * Helper functions to start and end a transaction with the controller. If an
+ * asynchronous flush is still in progress, it is waited on first. Inside a
+ * frame, the first transaction leaves CS low for the rest of it, and
+ * endFrame() raises it.
+ */
+static inline void enableController() {
+    if(cur->frameSelected) return;
+#ifdef NOKIA_ASYNC
+    waitFlush();
+#endif
+    writeBit(enableP, enableM, 0);
+    if(cur->frameDepth) cur->frameSelected = 1;
+}
+
+static inline void disableController() {
+    if(!cur->frameSelected) writeBit(enableP, enableM, 1);
+}
+
+/*
+ * Helper macro to bit bang a single bit of the byte being sent.
+ */
+#define SEND_BIT(mask) do { \
+        writeBit(dataP, dataM, byte & (mask)); \
+        writeBit(clockP, clockM, 1); \
+        writeBit(clockP, clockM, 0); \
+    } while(0)
+
 /*
  * Send data or a command to the controller. If dc is true, the byte is
  * interpreted as data, and if false, as a command. The passed byte is sent
- * MSB-first, with minimal delay between clock edges.
+ * MSB-first through the current transport, and has been fully shifted out by
+ * the time this returns (so D/C can safely change for the next byte).
  *
  * WARNING: Bit banging as fast as possible works fine on AVR microcontrollers
  * with 16Mhz or slower clock cycle, but other architectures may not delay
@@ -51,31 +311,535 @@ static inline void incrementCoordinates() {
  * width, minimum of 250ns clock cycle.
  */
 static void send(uint8_t byte, uint8_t dc) {
+#ifndef NOKIA_STATIC_PINS
     uint8_t mask;
+#endif
 
     writeBit(selP, selM, dc);
 
-    for(mask = 0x80; mask; mask >>= 1) {
-        writeBit(dataP, dataM, byte & mask);
-        *clockP |= clockM;
-        *clockP &= ~clockM;
+    switch(transport) {
+#ifdef SPDR
+        case TRANSPORT_SPI:
+            SPDR = byte;
+            while(!(SPSR & _BV(SPIF)));
+            return;
+#endif
+#ifdef UDR0
+        case TRANSPORT_USART:
+            // Writing a one clears the transmit complete flag. The other
+            // writable bits are unused in master SPI mode, so a plain write
+            // saves reading the register first
+            USART(UCSR, A) = _BV(USART(TXC,));
+            USART(UDR,) = byte;
+            while(!(USART(UCSR, A) & _BV(USART(TXC,))));
+            return;
+#endif
+        case TRANSPORT_CUSTOM:
+            customWrite(byte, dc);
+            return;
     }
+
+#ifdef NOKIA_STATIC_PINS
+    // Unrolled, each bit is a skip, an sbi or cbi, then an sbi/cbi pair
+    SEND_BIT(0x80);
+    SEND_BIT(0x40);
+    SEND_BIT(0x20);
+    SEND_BIT(0x10);
+    SEND_BIT(0x08);
+    SEND_BIT(0x04);
+    SEND_BIT(0x02);
+    SEND_BIT(0x01);
+#else
+    for(mask = 0x80; mask; mask >>= 1) SEND_BIT(mask);
+#endif
 }
 
 /*
  * Helper function to send new X/Y coords to the controller if necessary
  */
 static inline void setCoordinates(uint8_t newX, uint8_t newY) {
-    if(x != newX) {
-        x = newX;
-        send(CMD_X | x, 0);
+    if(cur->x != newX) {
+        cur->x = newX;
+        send(CMD_X | cur->x, 0);
+    }
+    if(cur->y != newY) {
+        cur->y = newY;
+        send(CMD_Y | cur->y, 0);
+    }
+}
+
+#ifndef NOKIA_NO_MIRROR
+/*
+ * Helper function to check if the mirror can be used for the send about to
+ * happen. It can only be trusted once all of the controller's ram has been
+ * written, which is always the case after the first clear(), so a send that
+ * covers the whole buffer makes it valid for the next one.
+ */
+static uint8_t trustMirror() {
+    uint8_t bank;
+
+    if(cur->mirrorValid) return 1;
+
+    cur->mirrorValid = 1;
+    for(bank = 0; bank < Y_HEIGHT; bank++)
+        if(cur->dirtyMin[bank] != 0 || cur->dirtyMax[bank] != LCD_WIDTH - 1)
+            cur->mirrorValid = 0;
+    return 0;
+}
+#endif
+
+/*
+ * Transpose an 8x8 block of pixels from row bytes (MSB leftmost) to column
+ * bytes (LSB topmost) using a shift network, as in Hacker's Delight. Only the
+ * first count rows, each stride bytes apart, are read; the rest are blank.
+ */
+static void transposeBlock(const uint8_t * rows, uint8_t stride, uint8_t count,
+        uint8_t * columns) {
+    uint8_t block[8] = {0}, i;
+    uint32_t top, bottom, t;
+
+    for(i = 0; i < count; i++, rows += stride) block[i] = *rows;
+
+    // Packing the rows bottom first leaves the top row in each column's LSB.
+    // Only whole byte shifts by constants, which AVR does as register moves.
+    top = (uint32_t)block[7] << 24 | (uint32_t)block[6] << 16 |
+            (uint16_t)block[5] << 8 | block[4];
+    bottom = (uint32_t)block[3] << 24 | (uint32_t)block[2] << 16 |
+            (uint16_t)block[1] << 8 | block[0];
+
+    t = (top ^ (top >> 7)) & 0x00AA00AA;
+    top = top ^ t ^ (t << 7);
+    t = (bottom ^ (bottom >> 7)) & 0x00AA00AA;
+    bottom = bottom ^ t ^ (t << 7);
+
+    t = (top ^ (top >> 14)) & 0x0000CCCC;
+    top = top ^ t ^ (t << 14);
+    t = (bottom ^ (bottom >> 14)) & 0x0000CCCC;
+    bottom = bottom ^ t ^ (t << 14);
+
+    t = (top & 0xF0F0F0F0) | ((bottom >> 4) & 0x0F0F0F0F);
+    bottom = ((top << 4) & 0xF0F0F0F0) | (bottom & 0x0F0F0F0F);
+    top = t;
+
+    columns[0] = top >> 24;
+    columns[1] = top >> 16;
+    columns[2] = top >> 8;
+    columns[3] = top;
+    columns[4] = bottom >> 24;
+    columns[5] = bottom >> 16;
+    columns[6] = bottom >> 8;
+    columns[7] = bottom;
+}
+
+#ifdef NOKIA_ROTATION
+// Every byte with its bits reversed, for flipping a bank upside down
+#define R2(n) n, n + 2*64, n + 1*64, n + 3*64
+#define R4(n) R2(n), R2(n + 2*16), R2(n + 1*16), R2(n + 3*16)
+#define R6(n) R4(n), R4(n + 2*4), R4(n + 1*4), R4(n + 3*4)
+static const uint8_t reversedBits[256] PROGMEM = {
+    R6(0), R6(2), R6(1), R6(3)
+};
+
+// Transformed columns of the bank being sent
+static uint8_t rotated[LCD_WIDTH];
+
+/*
+ * Helper function to get the bytes to send for columns minX through maxX of
+ * one of the controller's banks, indexed by column. Untransformed, that is
+ * just the buffer; otherwise they are worked out into rotated.
+ */
+static const uint8_t * physicalBank(uint8_t bank, uint8_t minX, uint8_t maxX) {
+    uint8_t transform = cur->transform, curX, column, row, block = 0xFF, byte,
+            columns[8];
+
+    if(!transform) return cur->buffer + bank*LCD_WIDTH;
+    if(transform & TRANSFORM_FLIP_Y) bank = Y_HEIGHT - 1 - bank;
+
+    for(curX = minX; curX <= maxX; curX++) {
+        column = transform & TRANSFORM_FLIP_X ? LCD_WIDTH - 1 - curX : curX;
+        if(transform & TRANSFORM_TRANSPOSE) {
+            // The 8 buffer columns that make up this bank cover 8 of its
+            // columns per transposed block, so each block is done once
+            row = LCD_WIDTH - 1 - column;
+            if(row >> 3 != block) {
+                block = row >> 3;
+                transposeBlock(cur->buffer + block*LCD_HEIGHT + (bank << 3), 1,
+                        8, columns);
+            }
+            byte = columns[7 - (row & 7)];
+        } else {
+            byte = cur->buffer[bank*LCD_WIDTH + column];
+        }
+        rotated[curX] = transform & TRANSFORM_FLIP_Y ?
+                pgm_read_byte(reversedBits + byte) : byte;
+    }
+
+    return rotated;
+}
+#else
+static inline const uint8_t * physicalBank(uint8_t bank, uint8_t minX,
+        uint8_t maxX) {
+    return cur->buffer + bank*LCD_WIDTH;
+}
+#endif
+
+/*
+ * Helper function to combine the masked bits of a byte with the buffer using
+ * the raster operation op. Bits outside the mask are left alone.
+ */
+static inline void mergeByte(uint8_t * curBufByte, uint8_t byte, uint8_t mask,
+        uint8_t op) {
+    switch(op) {
+        case ROP_COPY:
+            *curBufByte = (*curBufByte & ~mask) | (byte & mask);
+            break;
+        case ROP_XOR:
+            *curBufByte ^= byte & mask;
+            break;
+        case ROP_AND_NOT:
+            *curBufByte &= ~(byte & mask);
+            break;
+        case ROP_INVERT:
+            *curBufByte = (*curBufByte & ~mask) | (~byte & mask);
+            break;
+        default:
+            *curBufByte |= byte & mask;
     }
-    if(y != newY) {
-        y = newY;
-        send(CMD_Y | y, 0);
+}
+
+#ifdef NOKIA_LAYERS
+/*
+ * Helper function to rebuild the parts of the buffer that changed in any of
+ * the display's layers, by merging every shown layer from the bottom up. Only
+ * bytes that come out different are marked dirty.
+ */
+static void composite() {
+    struct nokiaLayer * layer;
+    uint8_t bank, curX, minX, maxX, changedMin, changedMax, n, byte;
+    uint16_t i;
+
+    for(bank = 0; bank < BANKS; bank++) {
+        minX = 0xFF;
+        maxX = 0;
+        for(n = 0; n < cur->layerCount; n++) {
+            layer = cur->layers[n];
+            if(layer->dirtyMin[bank] < minX) minX = layer->dirtyMin[bank];
+            if(layer->dirtyMax[bank] > maxX) maxX = layer->dirtyMax[bank];
+            layer->dirtyMin[bank] = 0xFF;
+            layer->dirtyMax[bank] = 0;
+        }
+
+        changedMin = 0xFF;
+        changedMax = 0;
+        for(curX = minX; curX <= maxX; curX++) {
+            i = bank*WIDTH + curX;
+            byte = 0;
+            for(n = 0; n < cur->layerCount; n++) {
+                layer = cur->layers[n];
+                if(layer->visible)
+                    mergeByte(&byte, layer->plane[i], 0xFF, layer->op);
+            }
+            if(cur->buffer[i] == byte) continue;
+
+            cur->buffer[i] = byte;
+            if(changedMin == 0xFF) changedMin = curX;
+            changedMax = curX;
+        }
+        if(changedMin <= changedMax) markBuffer(bank, changedMin, changedMax);
     }
 }
+#endif
 
+#ifndef NOKIA_BANDED
+/*
+ * Send every dirty span in the buffer and mark them clean. The controller must
+ * already be enabled.
+ *
+ * Unless NOKIA_NO_MIRROR is defined, a copy of the controller's ram is kept so
+ * that bytes which didn't actually change can be skipped. Skipping means
+ * re-addressing before the next changed byte, so a gap is only skipped when
+ * that costs fewer bytes than resending it.
+ */
+static void sendDirty() {
+    uint8_t bank, curX, minX, maxX;
+    const uint8_t * row;
+#ifndef NOKIA_NO_MIRROR
+    uint8_t * mirror, useMirror = trustMirror();
+#endif
+
+#ifdef NOKIA_LAYERS
+    composite();
+#endif
+
+    for(bank = 0; bank < Y_HEIGHT; bank++) {
+        if(cur->dirtyMin[bank] > cur->dirtyMax[bank]) continue;
+
+        minX = cur->dirtyMin[bank];
+        maxX = cur->dirtyMax[bank];
+        // Columns just before the span may be resent instead of re-addressing
+        row = physicalBank(bank,
+                minX > READDRESS_COST ? minX - READDRESS_COST : 0, maxX);
+#ifndef NOKIA_NO_MIRROR
+        mirror = cur->mirror + bank*LCD_WIDTH;
+#endif
+        for(curX = minX; curX <= maxX; curX++) {
+#ifndef NOKIA_NO_MIRROR
+            if(useMirror && mirror[curX] == row[curX]) continue;
+
+            // Resend a short run of unchanged bytes rather than re-address
+            if(cur->y == bank && cur->x < curX && curX - cur->x <= READDRESS_COST) {
+                while(cur->x != curX) {
+                    send(row[cur->x], 1);
+                    incrementCoordinates();
+                }
+            }
+            mirror[curX] = row[curX];
+#endif
+            setCoordinates(curX, bank);
+            send(row[curX], 1);
+            incrementCoordinates();
+        }
+        markClean(bank);
+    }
+}
+#endif
+
+/*
+ * Helper function called at the end of every drawing function. Unless
+ * deferred mode is on, whatever was just drawn is sent right away. Inside a
+ * frame, it is sent by endFrame() instead.
+ */
+static inline void autoFlush() {
+#ifndef NOKIA_BANDED
+    if(cur->frameDepth) return;
+    if(cur->deferred) {
+        // Counted so that each paced frame knows how many updates it merged
+        if(cur->frameInterval) cur->updates++;
+        return;
+    }
+
+    enableController();
+    sendDirty();
+    disableController();
+#endif
+}
+
+#ifdef NOKIA_ASYNC
+/*
+ * Helper function to start sending a byte without waiting for it to finish.
+ * Completion is signalled by the transport's interrupt calling
+ * flushInterrupt().
+ */
+static inline void startByte(uint8_t byte, uint8_t dc) {
+    writeBit(selP, selM, dc);
+
+    switch(transport) {
+#ifdef SPDR
+        case TRANSPORT_SPI:
+            SPDR = byte;
+            break;
+#endif
+#ifdef UDR0
+        case TRANSPORT_USART:
+            USART(UCSR, A) = _BV(USART(TXC,));
+            USART(UDR,) = byte;
+            break;
+#endif
+        case TRANSPORT_CUSTOM:
+            customWrite(byte, dc);
+            break;
+    }
+}
+
+/*
+ * Helper function to turn the current transport's completion interrupt on or
+ * off.
+ */
+static inline void setTransportInterrupt(uint8_t on) {
+    switch(transport) {
+#ifdef SPDR
+        case TRANSPORT_SPI:
+            if(on) SPCR |= _BV(SPIE);
+            else SPCR &= ~_BV(SPIE);
+            break;
+#endif
+#ifdef UDR0
+        case TRANSPORT_USART:
+            if(on) USART(UCSR, B) |= _BV(USART(TXCIE,));
+            else USART(UCSR, B) &= ~_BV(USART(TXCIE,));
+            break;
+#endif
+    }
+}
+
+void flushInterrupt(void) {
+    struct nokiaDisplay * interrupted = cur;
+
+    if(!txBusy) return;
+
+    // The transfer belongs to the display that started it, which may not be
+    // the one the interrupted code is using
+    cur = txDisplay;
+    while(txBank < Y_HEIGHT && txMin[txBank] > txMax[txBank]) txBank++;
+    if(txBank == Y_HEIGHT) {
+        // The last byte has been shifted out
+        setTransportInterrupt(0);
+        disableController();
+        txBusy = 0;
+    } else if(cur->x != txMin[txBank]) {
+        cur->x = txMin[txBank];
+        startByte(CMD_X | cur->x, 0);
+    } else if(cur->y != txBank) {
+        cur->y = txBank;
+        startByte(CMD_Y | cur->y, 0);
+    } else {
+        txMin[txBank]++;
+        incrementCoordinates();
+        startByte(txBuffer[txBank*LCD_WIDTH + txMin[txBank] - 1], 1);
+    }
+    cur = interrupted;
+}
+
+#ifdef SPDR
+#if !defined(NOKIA_TRANSPORT) || NOKIA_TRANSPORT == TRANSPORT_SPI
+ISR(SPI_STC_vect) {
+    flushInterrupt();
+}
+#endif
+#endif
+
+#ifdef UDR0
+#if !defined(NOKIA_TRANSPORT) || NOKIA_TRANSPORT == TRANSPORT_USART
+ISR(USART_TX_VECT) {
+    flushInterrupt();
+}
+#endif
+#endif
+
+int flushAsync() {
+    uint8_t bank, minX, maxX, pending = 0;
+    uint16_t i;
+    const uint8_t * row;
+#ifndef NOKIA_NO_MIRROR
+    uint8_t useMirror;
+#endif
+
+    if(!cur->initialized) return 0;
+    // Nothing would ever call flushInterrupt() for bit banging, and a frame
+    // already holds the controller
+    if(transport == TRANSPORT_BITBANG || cur->frameDepth) return flush();
+
+    waitFlush();
+#ifdef NOKIA_LAYERS
+    composite();
+#endif
+#ifndef NOKIA_NO_MIRROR
+    useMirror = trustMirror();
+#endif
+
+    // Copy the dirty spans to the front buffer so drawing can continue
+    for(bank = 0; bank < Y_HEIGHT; bank++) {
+        minX = cur->dirtyMin[bank];
+        maxX = cur->dirtyMax[bank];
+        markClean(bank);
+        i = bank*LCD_WIDTH;
+        row = minX <= maxX ? physicalBank(bank, minX, maxX) : 0;
+#ifndef NOKIA_NO_MIRROR
+        // Trim unchanged bytes from both ends of the span
+        if(useMirror) {
+            while(minX <= maxX && cur->mirror[i + minX] == row[minX]) minX++;
+            while(minX < maxX && cur->mirror[i + maxX] == row[maxX]) maxX--;
+        }
+        if(minX <= maxX)
+            memcpy(cur->mirror + i + minX, row + minX, maxX - minX + 1);
+#endif
+        if(minX <= maxX) {
+            memcpy(txBuffer + i + minX, row + minX, maxX - minX + 1);
+            pending = 1;
+        }
+        txMin[bank] = minX;
+        txMax[bank] = maxX;
+    }
+
+    // Don't touch CS or the interrupt for a transfer with nothing in it
+    if(!pending) return 1;
+
+    enableController();
+    txDisplay = cur;
+    txBank = 0;
+    txBusy = 1;
+    // Start the first byte before its completion can be interrupted on
+    flushInterrupt();
+    if(txBusy) setTransportInterrupt(1);
+
+    return 1;
+}
+
+uint8_t isFlushBusy() {
+    return txBusy;
+}
+
+void waitFlush() {
+    while(txBusy);
+    // The interrupt changed state that the compiler may have cached
+    __asm__ __volatile__("" ::: "memory");
+}
+#endif
+
+/*
+ * Helper function to pulse the reset line and put the other pins in their
+ * idle state, once the pins are known.
+ */
+static void resetController() {
+#ifndef NOKIA_BANDED
+    uint8_t bank;
+#endif
+
+    writeBit(resP, resM, 0);
+
+    writeBit(enableP, enableM, 1);
+    writeBit(clockP, clockM, 0);
+
+    writeBit(resP, resM, 1);
+
+    // The controller starts at the origin, powered down
+    cur->x = cur->y = 0;
+    cur->powerMode = 4;
+    cur->deferred = 0;
+    cur->frameDepth = cur->frameSelected = 0;
+#ifndef NOKIA_BANDED
+    cur->frameInterval = 0;
+    cur->updates = 0;
+    memset(&cur->frameStats, 0, sizeof(cur->frameStats));
+#endif
+#ifdef NOKIA_ROTATION
+    cur->width = LCD_WIDTH;
+    cur->height = LCD_HEIGHT;
+    cur->banks = Y_HEIGHT;
+    cur->transform = 0;
+#endif
+#ifdef NOKIA_LAYERS
+    cur->layerCount = 0;
+    cur->target = 0;
+#endif
+#ifdef NOKIA_BANDED
+    // Drawing does nothing until drawBanded() picks a band
+    cur->bandFirst = cur->bandBanks = 0;
+#else
+    for(bank = 0; bank < Y_HEIGHT; bank++) markClean(bank);
+#endif
+#ifndef NOKIA_NO_MIRROR
+    cur->mirrorValid = 0;
+#endif
+    cur->initialized = 1;
+}
+
+#ifdef NOKIA_STATIC_PINS
+int initStaticController() {
+    resetController();
+    return 1;
+}
+#else
 int initController(volatile uint8_t * resPort, uint8_t resBit,
         volatile uint8_t * enablePort, uint8_t enableBit,
         volatile uint8_t * selectorPort, uint8_t selectorBit,
@@ -84,67 +848,287 @@ int initController(volatile uint8_t * resPort, uint8_t resBit,
     if(resBit > 7 || enableBit > 7 || dataBit > 7 || clockBit > 7 || selectorBit > 7)
         return 0;
 
-    resM = 1 << resBit;
-    *resPort &= resM;
-
     resP = resPort;
     enableP = enablePort;
     dataP = dataPort;
     clockP = clockPort;
     selP = selectorPort;
 
+    resM = 1 << resBit;
     enableM = 1 << enableBit;
     dataM = 1 << dataBit;
     clockM = 1 << clockBit;
     selM = 1 << selectorBit;
 
-    *enableP |= enableM;
-    *clockP &= clockM;
+    resetController();
+    return 1;
+}
+#endif
 
-    *resP |= resM;
+/*
+ * Helper function to release whichever hardware peripheral the current
+ * transport uses, giving the pins back to their port registers.
+ */
+static inline void stopTransport() {
+    switch(transport) {
+#ifdef SPDR
+        case TRANSPORT_SPI:
+            SPCR = 0;
+            break;
+#endif
+#ifdef UDR0
+        case TRANSPORT_USART:
+            USART(UCSR, B) = 0;
+            USART(UCSR, C) = 0;
+            break;
+#endif
+    }
+}
+
+int setTransport(uint8_t newTransport) {
+    if(!cur->initialized) return 0;
+#ifdef NOKIA_TRANSPORT
+    if(newTransport != NOKIA_TRANSPORT) return 0;
+#endif
+
+    switch(newTransport) {
+        case TRANSPORT_BITBANG:
+            stopTransport();
+            break;
+#ifdef SPDR
+        case TRANSPORT_SPI:
+            stopTransport();
+            SPCR = _BV(SPE) | _BV(MSTR) | SPI_CLOCK_BITS;
+            SPSR = SPI_STATUS_BITS;
+            break;
+#endif
+#ifdef UDR0
+        case TRANSPORT_USART:
+            // The datasheet requires the baud rate to be zero while enabling
+            stopTransport();
+            USART(UBRR,) = 0;
+            USART(UCSR, C) = _BV(USART(UMSEL, 1)) | _BV(USART(UMSEL, 0));
+            USART(UCSR, B) = _BV(USART(TXEN,));
+            USART(UBRR,) = USART_UBRR;
+            break;
+#endif
+        default:
+            return 0;
+    }
+#ifndef NOKIA_TRANSPORT
+    transport = newTransport;
+#endif
+
+    return 1;
+}
+
+int setCustomTransport(void (*write)(uint8_t byte, uint8_t dc)) {
+    if(!cur->initialized || write == 0) return 0;
+#if defined(NOKIA_TRANSPORT) && NOKIA_TRANSPORT != TRANSPORT_CUSTOM
+    return 0;
+#else
+
+#ifndef NOKIA_TRANSPORT
+    stopTransport();
+    transport = TRANSPORT_CUSTOM;
+#endif
+    customWrite = write;
+
+    return 1;
+#endif
+}
+
+void useDisplay(struct nokiaDisplay * display) {
+    cur = display ? display : &defaultDisplay;
+}
+
+#ifdef NOKIA_LAYERS
+int initLayer(struct nokiaLayer * layer, uint8_t op) {
+    uint8_t bank;
+
+    if(op > ROP_INVERT) return 0;
+
+    memset(layer->plane, 0, sizeof(layer->plane));
+    for(bank = 0; bank < NOKIA_BUFFER_BANKS; bank++) {
+        layer->dirtyMin[bank] = 0xFF;
+        layer->dirtyMax[bank] = 0;
+    }
+    layer->op = op;
+    layer->visible = 1;
+
+    return 1;
+}
+
+int setLayers(struct nokiaLayer * const * layers, uint8_t count) {
+    uint8_t n, bank;
+
+    if(!cur->initialized) return 0;
+
+    // Anything still pending on the old layers is merged first
+    composite();
+    cur->layers = layers;
+    cur->layerCount = count;
+    cur->target = 0;
+    // The whole screen is rebuilt from the new stack
+    for(n = 0; n < count; n++)
+        for(bank = 0; bank < BANKS; bank++)
+            markLayer(layers[n], bank, 0, WIDTH - 1);
+    autoFlush();
 
-    initialized = 1;
     return 1;
 }
 
+void useLayer(struct nokiaLayer * layer) {
+    cur->target = layer;
+}
+
+int showLayer(struct nokiaLayer * layer, uint8_t visible) {
+    uint8_t bank, minX, maxX, n, opaque;
+    const uint8_t * row, * below = 0;
+
+    if(!cur->initialized) return 0;
+    visible = visible != 0;
+    if(layer->visible == visible) return 1;
+    layer->visible = visible;
+
+    // An opaque layer straight over a visible one with the same op hides it
+    // completely, so only shows something different where their planes
+    // differ
+    opaque = layer->op == ROP_COPY || layer->op == ROP_INVERT;
+    for(n = 1; n < cur->layerCount && opaque; n++) {
+        if(cur->layers[n] == layer && cur->layers[n - 1]->visible &&
+                cur->layers[n - 1]->op == layer->op)
+            below = cur->layers[n - 1]->plane;
+    }
+
+    // Blank bytes of OR, XOR and AND_NOT layers change nothing, so only the
+    // span each bank has anything in needs compositing again
+    for(bank = 0; bank < BANKS; bank++) {
+        row = layer->plane + bank*WIDTH;
+        minX = 0;
+        maxX = WIDTH - 1;
+        if(below) {
+            while(minX <= maxX && row[minX] == below[bank*WIDTH + minX])
+                minX++;
+            while(minX < maxX && row[maxX] == below[bank*WIDTH + maxX])
+                maxX--;
+        } else if(!opaque) {
+            while(minX <= maxX && !row[minX]) minX++;
+            while(minX < maxX && !row[maxX]) maxX--;
+        }
+        if(minX <= maxX) markLayer(layer, bank, minX, maxX);
+    }
+    autoFlush();
+
+    return 1;
+}
+#endif
+
+#if !defined(NOKIA_STATIC_PINS) && !defined(NOKIA_BANDED)
+int broadcast(struct nokiaDisplay * const * displays, uint8_t count) {
+    struct nokiaDisplay * display;
+    uint8_t n, bank, curX;
+    const uint8_t * row;
+
+    // Raising CS on every display would end the current frame early
+    if(!cur->initialized || cur->frameDepth) return 0;
+    for(n = 0; n < count; n++) {
+        if(!displays[n]->initialized) return 0;
+#ifdef NOKIA_ROTATION
+        // The buffer is only copied as it is, so it must mean the same thing
+        if(displays[n]->transform != cur->transform) return 0;
+#endif
+    }
+
+#ifdef NOKIA_LAYERS
+    composite();
+#endif
+    enableController();
+    for(n = 0; n < count; n++)
+        writeBit(displays[n]->enablePort, displays[n]->enableMask, 0);
+
+    // Every controller is moved to the origin, then given the whole buffer,
+    // which leaves them all back at the origin
+    for(n = 0; n < count; n++)
+        writeBit(displays[n]->selPort, displays[n]->selMask, 0);
+    send(CMD_X, 0);
+    send(CMD_Y, 0);
+    for(n = 0; n < count; n++)
+        writeBit(displays[n]->selPort, displays[n]->selMask, 1);
+    for(bank = 0; bank < Y_HEIGHT; bank++) {
+        row = physicalBank(bank, 0, LCD_WIDTH - 1);
+        for(curX = 0; curX < LCD_WIDTH; curX++) send(row[curX], 1);
+#ifndef NOKIA_NO_MIRROR
+        memcpy(cur->mirror + bank*LCD_WIDTH, row, LCD_WIDTH);
+#endif
+    }
+
+    for(n = 0; n < count; n++)
+        writeBit(displays[n]->enablePort, displays[n]->enableMask, 1);
+    disableController();
+
+    cur->x = cur->y = 0;
+    for(bank = 0; bank < Y_HEIGHT; bank++) markClean(bank);
+#ifndef NOKIA_NO_MIRROR
+    cur->mirrorValid = 1;
+#endif
+
+    for(n = 0; n < count; n++) {
+        display = displays[n];
+        if(display == cur) continue;
+
+        memcpy(display->buffer, cur->buffer, sizeof(cur->buffer));
+        memcpy(display->dirtyMin, cur->dirtyMin, Y_HEIGHT);
+        memcpy(display->dirtyMax, cur->dirtyMax, Y_HEIGHT);
+#ifndef NOKIA_NO_MIRROR
+        memcpy(display->mirror, cur->mirror, BUFFER_SIZE);
+        display->mirrorValid = 1;
+#endif
+        display->x = display->y = 0;
+    }
+
+    return 1;
+}
+#endif
+
 int setExtendedRegisters(uint8_t bias, uint8_t vop, uint8_t tc) {
-    if(!initialized || bias > 7 || vop > 0x7f || tc > 3) return 0;
+    if(!cur->initialized || bias > 7 || vop > 0x7f || tc > 3) return 0;
 
-    *enableP  &= ~enableM;
-    send(CMD_EXTENDED | powerMode | vertical, 0);
+    enableController();
+    send(CMD_EXTENDED | cur->powerMode, 0);
     send(CMD_VOP | vop, 0);
     send(CMD_BIAS | bias, 0);
     send(CMD_TC | tc, 0);
-    send(CMD_NORMAL | powerMode | vertical, 0);
-    *enableP |= enableM;
+    send(CMD_NORMAL | cur->powerMode, 0);
+    disableController();
 
     return 1;
 }
 
 int defaultSetExtendedRegisters() {
-    if(!initialized) return 0;
+    if(!cur->initialized) return 0;
 
-    *enableP  &= ~enableM;
-    send(CMD_EXTENDED | powerMode | vertical, 0);
+    enableController();
+    send(CMD_EXTENDED | cur->powerMode, 0);
     send(CMD_VOP | 0x7f, 0);
     send(CMD_BIAS | 4, 0);
-    send(CMD_NORMAL | powerMode | vertical, 0);
-    *enableP |= enableM;
+    send(CMD_NORMAL | cur->powerMode, 0);
+    disableController();
 
     return 1;
 }
 
 int setDisplayMode(uint8_t mode) {
-    if(!initialized) return 0;
+    if(!cur->initialized) return 0;
 
     switch(mode) {
         case DISPLAY_MODE_BLANK:
         case DISPLAY_MODE_ALL:
         case DISPLAY_MODE_NORMAL:
         case DISPLAY_MODE_INVERSE:
-            *enableP  &= ~enableM;
+            enableController();
             send(CMD_DISPLAY_MODE | mode, 0);
-            *enableP |= enableM;
+            disableController();
             return 1;
         default:
             return 0;
@@ -152,70 +1136,587 @@ int setDisplayMode(uint8_t mode) {
 }
 
 int setPowerMode(uint8_t mode) {
-    if(!initialized) return 0;
+    if(!cur->initialized) return 0;
+
+    if(mode) cur->powerMode = 4;
+    else cur->powerMode = 0;
+    enableController();
+    send(CMD_NORMAL | cur->powerMode, 0);
+    disableController();
+
+    return 1;
+}
+
+int setDeferredMode(uint8_t mode) {
+    if(!cur->initialized) return 0;
+
+    // Anything drawn while deferred is sent when leaving the mode
+    cur->deferred = 0;
+#ifndef NOKIA_BANDED
+    cur->frameInterval = 0;
+#endif
+    autoFlush();
+    cur->deferred = mode != 0;
+
+    return 1;
+}
+
+int flush() {
+    if(!cur->initialized) return 0;
+
+#ifndef NOKIA_BANDED
+    enableController();
+    sendDirty();
+    disableController();
+#endif
+
+    return 1;
+}
+
+#ifndef NOKIA_BANDED
+int setFrameInterval(uint8_t interval) {
+    if(!setDeferredMode(interval != 0)) return 0;
+
+    cur->frameInterval = interval;
+    cur->updates = 0;
+    // The first frame is due straight away
+    cur->lastFrame = frameTicks - interval;
+
+    return 1;
+}
+
+void frameTick(void) {
+    frameTicks++;
+}
+
+uint8_t framePoll() {
+    uint8_t elapsed;
+
+    if(!cur->initialized || !cur->frameInterval) return 0;
+
+    elapsed = frameTicks - cur->lastFrame;
+    if(elapsed < cur->frameInterval) return 0;
+    if(!cur->updates) {
+        // Nothing waiting, so no slot is missed, and the next update can go
+        // out as soon as it is polled
+        cur->lastFrame = frameTicks - cur->frameInterval;
+        return 0;
+    }
+#ifdef NOKIA_ASYNC
+    // The last frame is still going out
+    if(isFlushBusy()) return 0;
+#endif
+
+    cur->frameStats.frames++;
+    cur->frameStats.coalesced += cur->updates - 1;
+    cur->frameStats.dropped += elapsed / cur->frameInterval - 1;
+    cur->updates = 0;
+    // Frames stay on the interval's beat, however late this poll was
+    cur->lastFrame += elapsed - elapsed % cur->frameInterval;
+#ifdef NOKIA_ASYNC
+    flushAsync();
+#else
+    flush();
+#endif
+
+    return 1;
+}
+
+int takeFrameStats(struct nokiaFrameStats * stats) {
+    if(!cur->initialized) return 0;
 
-    if(mode) powerMode = 4;
-    else powerMode = 0;
-    *enableP  &= ~enableM;
-    send(CMD_NORMAL | powerMode | vertical, 0);
-    *enableP |= enableM;
+    *stats = cur->frameStats;
+    memset(&cur->frameStats, 0, sizeof(cur->frameStats));
+
+    return 1;
+}
+#endif
+
+int beginFrame() {
+    if(!cur->initialized || cur->frameDepth == 0xFF) return 0;
+
+    cur->frameDepth++;
+
+    return 1;
+}
+
+int endFrame() {
+#ifndef NOKIA_BANDED
+    uint8_t bank;
+#endif
+
+    if(!cur->initialized || !cur->frameDepth) return 0;
+    if(--cur->frameDepth) return 1;
+
+#ifdef NOKIA_LAYERS
+    if(!cur->deferred) composite();
+#endif
+#ifndef NOKIA_BANDED
+    if(cur->deferred && cur->frameInterval) cur->updates++;
+    // Everything drawn in the frame goes out in the same transaction as
+    // anything already sent in it. A frame that changed nothing sends nothing.
+    for(bank = 0; bank < Y_HEIGHT && !cur->deferred; bank++) {
+        if(cur->dirtyMin[bank] <= cur->dirtyMax[bank]) {
+            enableController();
+            sendDirty();
+            break;
+        }
+    }
+#endif
+    cur->frameSelected = 0;
+    disableController();
 
     return 1;
 }
 
 int clear() {
-    if(!initialized) return 0;
+#ifdef NOKIA_BANDED
+    return drawBanded(0);
+#else
+    if(!cur->initialized) return 0;
 
     uint16_t i;
-    *enableP &= ~enableM;
-    for(i = 0; i < BUFFER_SIZE; i++) {
-        buffer[i] = 0;
-        send(0, 1);
+    uint8_t bank;
+    uint8_t * buffer = bankRow(0);
+    for(i = 0; i < sizeof(cur->buffer); i++) buffer[i] = 0;
+    for(bank = 0; bank < BANKS; bank++) markDirty(bank, 0, WIDTH - 1);
+    autoFlush();
+
+    return 1;
+#endif
+}
+
+#ifdef NOKIA_BANDED
+int drawBanded(void (*draw)(void)) {
+    uint8_t bank;
+    uint16_t i;
+
+    if(!cur->initialized || cur->bandBanks) return 0;
+
+    for(bank = 0; bank < Y_HEIGHT; bank += NOKIA_BAND_BANKS) {
+        cur->bandFirst = bank;
+        cur->bandBanks = Y_HEIGHT - bank < NOKIA_BAND_BANKS ?
+                Y_HEIGHT - bank : NOKIA_BAND_BANKS;
+        memset(cur->buffer, 0, sizeof(cur->buffer));
+        if(draw) draw();
+
+        // Banks follow each other in the controller's ram, so the band goes
+        // out as one run
+        enableController();
+        setCoordinates(0, bank);
+        for(i = 0; i < cur->bandBanks*LCD_WIDTH; i++) {
+            send(cur->buffer[i], 1);
+            incrementCoordinates();
+        }
+        disableController();
+    }
+    cur->bandBanks = 0;
+
+    return 1;
+}
+#endif
+
+#ifndef NOKIA_BANDED
+int scrollUp(uint8_t banks) {
+    uint8_t bank, curX, minX, maxX, byte, * curBufByte;
+
+    if(!cur->initialized || banks > BANKS) return 0;
+
+    // Copy each bank up, keeping track of which columns actually change so
+    // that only those are sent
+    for(bank = 0; bank < BANKS; bank++) {
+        curBufByte = bankRow(bank);
+        minX = 0xFF;
+        maxX = 0;
+        for(curX = 0; curX < WIDTH; curX++, curBufByte++) {
+            byte = bank + banks < BANKS ? curBufByte[banks*WIDTH] : 0;
+            if(*curBufByte == byte) continue;
+
+            *curBufByte = byte;
+            if(minX == 0xFF) minX = curX;
+            maxX = curX;
+        }
+        if(minX <= maxX) markDirty(bank, minX, maxX);
     }
-    *enableP |= enableM;
+    autoFlush();
 
     return 1;
 }
+#endif
+
+#ifdef NOKIA_ROTATION
+int setRotation(uint8_t rotation) {
+    uint8_t transform = 0;
+
+    if(!cur->initialized || rotation > (ROTATION_270 | MIRROR_X | MIRROR_Y))
+        return 0;
+
+    // 180 degrees is both flips, and 270 is 90 with both flips. Once
+    // transposed, the picture's x runs along the controller's y.
+    if(rotation & 1) transform = TRANSFORM_TRANSPOSE;
+    if(rotation & 2) transform |= TRANSFORM_FLIP_X | TRANSFORM_FLIP_Y;
+    if(rotation & MIRROR_X)
+        transform ^= rotation & 1 ? TRANSFORM_FLIP_Y : TRANSFORM_FLIP_X;
+    if(rotation & MIRROR_Y)
+        transform ^= rotation & 1 ? TRANSFORM_FLIP_X : TRANSFORM_FLIP_Y;
+
+    cur->transform = transform;
+    cur->width = rotation & 1 ? LCD_HEIGHT : LCD_WIDTH;
+    cur->height = rotation & 1 ? LCD_WIDTH : LCD_HEIGHT;
+    cur->banks = (cur->height + 7) >> 3;
+#ifdef NOKIA_LAYERS
+    // Layers drawn the old way round no longer fit
+    cur->layerCount = 0;
+    cur->target = 0;
+#endif
+
+    return clear();
+}
+#endif
+
+uint8_t screenWidth() {
+    return WIDTH;
+}
+
+uint8_t screenHeight() {
+    return HEIGHT;
+}
 
 int drawPixel(uint8_t x, uint8_t y, uint8_t state) {
-    if(!initialized || x >= LCD_WIDTH || y >= LCD_HEIGHT) return 0;
+    if(!cur->initialized || x >= WIDTH || y >= HEIGHT) return 0;
 
     uint8_t realY = y>>3, mask = 1<<(y&7);
-    uint8_t * byte = buffer + realY*LCD_WIDTH + x;
+    uint8_t * byte = bankRow(realY);
+    if(!byte) return 1;
+    byte += x;
     if(state) *byte |= mask;
     else *byte &= ~mask;
 
-    *enableP &= ~enableM;
-    setCoordinates(x, realY);
-    send(*byte, 1);
-    *enableP |= enableM;
-    incrementCoordinates();
+    markDirty(realY, x, x);
+    autoFlush();
+
+    return 1;
+}
+
+/*
+ * Helper function to set or clear the masked bits of a column in a bank, and
+ * mark it dirty. Nothing is sent.
+ */
+static inline void plotBits(uint8_t x, uint8_t bank, uint8_t mask, uint8_t state) {
+    uint8_t * byte = bankRow(bank);
+
+    if(!mask || !byte) return;
+    byte += x;
+    if(state) *byte |= mask;
+    else *byte &= ~mask;
+    markDirty(bank, x, x);
+}
+
+/*
+ * Helper function to plot a pixel which may be off screen, in which case it is
+ * ignored. Nothing is sent.
+ */
+static inline void plotClipped(int16_t x, int16_t y, uint8_t state) {
+    if(x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) return;
+    plotBits(x, y >> 3, 1 << (y & 7), state);
+}
+
+/*
+ * Helper function to fill a rectangle known to be on screen and mark it dirty.
+ * Each bank it covers gets a single mask, applied to a whole byte per column.
+ * Nothing is sent.
+ */
+static void fillSpan(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+        uint8_t state) {
+    uint8_t bank = y >> 3, lastY = y + height - 1, mask = 0xFF << (y & 7);
+    uint8_t * curBufByte, * maxBufByte;
+
+    for(; bank <= lastY >> 3; bank++) {
+        if(bank == lastY >> 3) mask &= 0xFF >> (7 - (lastY & 7));
+
+        curBufByte = bankRow(bank);
+        if(curBufByte) {
+            curBufByte += x;
+            maxBufByte = curBufByte + width;
+            if(state) for(; curBufByte < maxBufByte; curBufByte++) *curBufByte |= mask;
+            else for(; curBufByte < maxBufByte; curBufByte++) *curBufByte &= ~mask;
+
+            markDirty(bank, x, x + width - 1);
+        }
+        mask = 0xFF;
+    }
+}
+
+/*
+ * Helper function to fill a single column from top to bottom inclusive, either
+ * of which may be off screen.
+ */
+static void fillClippedColumn(int16_t x, int16_t top, int16_t bottom,
+        uint8_t state) {
+    if(x < 0 || x >= WIDTH) return;
+    if(top < 0) top = 0;
+    if(bottom >= HEIGHT) bottom = HEIGHT - 1;
+    if(top <= bottom) fillSpan(x, top, 1, bottom - top + 1, state);
+}
+
+/*
+ * Helper function to check that a rectangle is on screen.
+ */
+static inline uint8_t rectFits(uint8_t x, uint8_t y, uint8_t width,
+        uint8_t height) {
+    return x < WIDTH && y < HEIGHT &&
+            x + width <= WIDTH && y + height <= HEIGHT;
+}
+
+int drawHLine(uint8_t x, uint8_t y, uint8_t width, uint8_t state) {
+    return fillRect(x, y, width, 1, state);
+}
+
+int drawVLine(uint8_t x, uint8_t y, uint8_t height, uint8_t state) {
+    return fillRect(x, y, 1, height, state);
+}
+
+int fillRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+        uint8_t state) {
+    if(!cur->initialized || !rectFits(x, y, width, height)) return 0;
+    if(width == 0 || height == 0) return 1;
+
+    fillSpan(x, y, width, height, state);
+    autoFlush();
+
+    return 1;
+}
+
+int drawRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+        uint8_t state) {
+    if(!cur->initialized || !rectFits(x, y, width, height)) return 0;
+    if(width == 0 || height == 0) return 1;
+
+    fillSpan(x, y, width, 1, state);
+    fillSpan(x, y + height - 1, width, 1, state);
+    fillSpan(x, y, 1, height, state);
+    fillSpan(x + width - 1, y, 1, height, state);
+    autoFlush();
+
+    return 1;
+}
+
+int drawLine(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t state) {
+    int16_t dx, dy, error, doubled;
+    int8_t stepX, stepY;
+    uint8_t bank, mask = 0;
+
+    if(!cur->initialized || x0 >= WIDTH || y0 >= HEIGHT ||
+            x1 >= WIDTH || y1 >= HEIGHT) return 0;
+
+    // Straight lines are spans
+    if(y0 == y1) {
+        if(x0 > x1) return drawHLine(x1, y0, x0 - x1 + 1, state);
+        return drawHLine(x0, y0, x1 - x0 + 1, state);
+    }
+    if(x0 == x1) {
+        if(y0 > y1) return drawVLine(x0, y1, y0 - y1 + 1, state);
+        return drawVLine(x0, y0, y1 - y0 + 1, state);
+    }
+
+    dx = x1 > x0 ? x1 - x0 : x0 - x1;
+    dy = y1 > y0 ? y0 - y1 : y1 - y0;
+    stepX = x1 > x0 ? 1 : -1;
+    stepY = y1 > y0 ? 1 : -1;
+    error = dx + dy;
+    bank = y0 >> 3;
+
+    // Pixels are gathered into a mask for as long as the line stays in the
+    // same column and bank, so steep lines write a byte per bank, not per pixel
+    for(;;) {
+        mask |= 1 << (y0 & 7);
+        if(x0 == x1 && y0 == y1) break;
+
+        doubled = 2*error;
+        if(doubled >= dy) {
+            error += dy;
+            plotBits(x0, bank, mask, state);
+            mask = 0;
+            x0 += stepX;
+        }
+        if(doubled <= dx) {
+            error += dx;
+            y0 += stepY;
+            if(y0 >> 3 != bank) {
+                plotBits(x0, bank, mask, state);
+                mask = 0;
+                bank = y0 >> 3;
+            }
+        }
+    }
+    plotBits(x0, bank, mask, state);
+    autoFlush();
+
+    return 1;
+}
+
+int drawCircle(uint8_t x, uint8_t y, uint8_t radius, uint8_t state) {
+    int16_t dx = radius, dy = 0, error = 1 - radius;
+
+    if(!cur->initialized || x >= WIDTH || y >= HEIGHT) return 0;
+
+    // Midpoint circle, one octant at a time mirrored to the other seven
+    while(dx >= dy) {
+        plotClipped(x + dx, y + dy, state);
+        plotClipped(x - dx, y + dy, state);
+        plotClipped(x + dx, y - dy, state);
+        plotClipped(x - dx, y - dy, state);
+        plotClipped(x + dy, y + dx, state);
+        plotClipped(x - dy, y + dx, state);
+        plotClipped(x + dy, y - dx, state);
+        plotClipped(x - dy, y - dx, state);
+
+        dy++;
+        if(error < 0) {
+            error += 2*dy + 1;
+        } else {
+            dx--;
+            error += 2*(dy - dx) + 1;
+        }
+    }
+    autoFlush();
+
+    return 1;
+}
+
+int fillCircle(uint8_t x, uint8_t y, uint8_t radius, uint8_t state) {
+    int16_t dx = radius, dy = 0, error = 1 - radius;
+
+    if(!cur->initialized || x >= WIDTH || y >= HEIGHT) return 0;
+
+    // Filled as columns, since those are whole bytes in the buffer
+    while(dx >= dy) {
+        fillClippedColumn(x + dx, y - dy, y + dy, state);
+        fillClippedColumn(x - dx, y - dy, y + dy, state);
+        fillClippedColumn(x + dy, y - dx, y + dx, state);
+        fillClippedColumn(x - dy, y - dx, y + dx, state);
+
+        dy++;
+        if(error < 0) {
+            error += 2*dy + 1;
+        } else {
+            dx--;
+            error += 2*(dy - dx) + 1;
+        }
+    }
+    autoFlush();
+
+    return 1;
+}
+
+#ifndef NOKIA_BANDED
+int scrollLeft(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+        uint8_t columns) {
+    uint8_t bank, lastY = y + height - 1, mask, curX, byte, * row;
+
+    if(!cur->initialized || !rectFits(x, y, width, height) || columns > width)
+        return 0;
+    if(width == 0 || height == 0) return 1;
+
+    for(bank = y >> 3; bank <= lastY >> 3; bank++) {
+        mask = 0xFF;
+        if(bank == y >> 3) mask <<= y & 7;
+        if(bank == lastY >> 3) mask &= 0xFF >> (7 - (lastY & 7));
+        row = bankRow(bank) + x;
+
+        // Banks the region covers fully can be moved as they are
+        if(mask == 0xFF) {
+            memmove(row, row + columns, width - columns);
+            memset(row + width - columns, 0, columns);
+        } else {
+            for(curX = 0; curX < width; curX++) {
+                byte = curX + columns < width ? row[curX + columns] : 0;
+                row[curX] = (row[curX] & ~mask) | (byte & mask);
+            }
+        }
+        markDirty(bank, x, x + width - 1);
+    }
+    autoFlush();
+
+    return 1;
+}
+#endif
+
+/*
+ * Helper function to check whether a region starts on a bank boundary and its
+ * columns each start on a byte boundary in the data (padded, or a multiple of
+ * 8 tall). Banded drawing has to clip every byte, so never takes this path.
+ */
+static inline uint8_t alignedColumns(uint8_t y, uint8_t height,
+        uint8_t padding) {
+#ifdef NOKIA_BANDED
+    return 0;
+#else
+    return !(y & 7) && (padding || !(height & 7));
+#endif
+}
+
+/*
+ * Helper function for aligned regions (see alignedColumns). Every output byte
+ * is a whole input byte, apart from a partial last byte in each column which
+ * needs masking.
+ */
+static void copyAlignedColumns(uint8_t x, uint8_t realY, uint8_t width,
+        uint8_t height, const uint8_t * data, uint8_t op) {
+    uint8_t fullBanks = height >> 3, lastMask = 0xFF >> (8 - (height & 7));
+    uint8_t bank, * curBufByte,
+            * maxBufByte = bankRow(realY) + x + width;
+
+    for(curBufByte = maxBufByte - width; curBufByte < maxBufByte; curBufByte++) {
+        // Plain copies are by far the most common, so skip the merge for them
+        if(op == ROP_COPY) {
+            for(bank = 0; bank < fullBanks; bank++)
+                curBufByte[bank*WIDTH] = *data++;
+        } else {
+            for(bank = 0; bank < fullBanks; bank++)
+                mergeByte(curBufByte + bank*WIDTH, *data++, 0xFF, op);
+        }
+
+        if(lastMask)
+            mergeByte(curBufByte + bank*WIDTH, *data++, lastMask, op);
+    }
+}
+
+/*
+ * Helper function to mark a region's banks dirty once it has been drawn, and
+ * send them unless deferred.
+ */
+static int finishRegion(uint8_t x, uint8_t y, uint8_t width, uint8_t height) {
+    uint8_t bank;
+
+    for(bank = y >> 3; bank <= (y + height - 1) >> 3; bank++)
+        markDirty(bank, x, x + width - 1);
+    autoFlush();
 
     return 1;
 }
 
 int drawRegionColumns(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
-        const uint8_t * data, uint8_t padding, uint8_t opaque) {
+        const uint8_t * data, uint8_t padding, uint8_t op) {
     uint8_t bufBits, dataBits, bufOffset, curWriteByte, * curBufByte;
-    uint8_t curY, curRealY, remaining,
+    uint8_t curX, curY, curRealY, remaining,
             dataOffset = 0, realY = y >> 3, maxX = x + width;
 
-    if(!initialized || x >= LCD_WIDTH || y >= LCD_HEIGHT ||
-            maxX > LCD_WIDTH || y + height > LCD_HEIGHT) return 0;
-    if(width == 0 || height == 0) return 1;
+    if(!cur->initialized || x >= WIDTH || y >= HEIGHT ||
+            maxX > WIDTH || y + height > HEIGHT || op > ROP_INVERT)
+        return 0;
+    if(width == 0 || height == 0 || !inBand(y, height)) return 1;
 
-    *enableP &= ~enableM;
-    if(!vertical) {
-        send(CMD_NORMAL | powerMode | 2, 0);
-        vertical = 2;
+    if(alignedColumns(y, height, padding)) {
+        copyAlignedColumns(x, realY, width, height, data, op);
+        return finishRegion(x, y, width, height);
     }
 
-    while(x < maxX) {
+    for(curX = x; curX < maxX; curX++) {
         // Setup for current column
         remaining = height;
         curY = y;
         curRealY = realY;
-        setCoordinates(x, curRealY);
 
         // Each iteration writes a byte to the buffer and sends it
         while(remaining != 0) {
@@ -229,20 +1730,12 @@ int drawRegionColumns(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
             curWriteByte = *data >> dataOffset;
             dataBits = 8 - dataOffset;
             if(bufBits > dataBits) curWriteByte |= *(data + 1) << dataBits;
-            curWriteByte = (curWriteByte << bufOffset) &
-                    (0xFF >> (8-bufBits-bufOffset));
-
-            curBufByte = buffer + curRealY*LCD_WIDTH + x;
-            // If opaque, we want to write directly to the buffer but need to
-            // make sure unused bits around the used bits aren't overwritten.
-            if(opaque) *curBufByte = curWriteByte |
-                    (~(0xFF >> (8-bufBits) << bufOffset) & *curBufByte);
-            // If not, the unused bits are already cleared and won't overwrite
-            // when or'd with the buffer.
-            else *curBufByte |= curWriteByte;
-
-            send(*curBufByte, 1);
-            incrementCoordinates();
+            curWriteByte <<= bufOffset;
+
+            // Only the bits covered by the region may change
+            curBufByte = bankRow(curRealY);
+            if(curBufByte) mergeByte(curBufByte + curX, curWriteByte,
+                    0xFF >> (8-bufBits) << bufOffset, op);
 
             // Record keeping; next iteration uses these shifted values
             if(bufBits >= dataBits) data++;
@@ -258,35 +1751,32 @@ int drawRegionColumns(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
             data++;
             dataOffset = 0;
         }
-
-        x++;
     }
-    *enableP |= enableM;
 
-    return 1;
+    return finishRegion(x, y, width, height);
 }
 
 int drawRegionRows(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
-        const uint8_t * data, uint8_t padding, uint8_t opaque) {
-    uint8_t bufBits, dataBits, bufOffset, curWriteByte, * curBufByte;
-    uint8_t curX, remaining, rowOffset, dataOffset = 0, realY = y >> 3,
-            maxX = x + width, maxY = y + height, realMaxY = (maxY - 1) >> 3;
+        const uint8_t * data, uint8_t padding, uint8_t op) {
+    uint8_t bufBits, dataBits, bufOffset, curWriteByte, * row;
+    uint8_t curX, remaining, rowOffset = 0, dataOffset = 0, realY = y >> 3,
+            top = y, maxX = x + width, maxY = y + height,
+            realMaxY = (maxY - 1) >> 3;
     const uint8_t * curData;
-    if(!initialized || x >= LCD_WIDTH || y >= LCD_HEIGHT ||
-            maxX > LCD_WIDTH || maxY > LCD_HEIGHT) return 0;
-    if(width == 0 || height == 0) return 1;
+    if(!cur->initialized || x >= WIDTH || y >= HEIGHT ||
+            maxX > WIDTH || maxY > HEIGHT || op > ROP_INVERT) return 0;
+    if(width == 0 || height == 0 || !inBand(y, height)) return 1;
 
-    *enableP &= ~enableM;
-    if(vertical) {
-        send(CMD_NORMAL | powerMode, 0);
-        vertical = 0;
+    // The data is laid out the same way as for drawRegionColumns
+    if(alignedColumns(y, height, padding)) {
+        copyAlignedColumns(x, realY, width, height, data, op);
+        return finishRegion(x, y, width, height);
     }
 
     // The is evaluated as either the number of pixels or number of bytes
     if(padding) height = ((height - 1) >> 3) + 1;
     while(realY <= realMaxY) {
         curData = data;
-        setCoordinates(x, realY);
         if(!padding) rowOffset = dataOffset;
 
         bufOffset = y & 7;
@@ -294,6 +1784,7 @@ int drawRegionRows(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
         remaining = maxY - y;
         // Ensure we don't try to write extra bits below the region
         if(bufBits > remaining) bufBits = remaining;
+        row = bankRow(realY);
 
         for(curX = x; curX < maxX; curX++) {
             // This gets the correct number of bits from the input data and
@@ -301,20 +1792,11 @@ int drawRegionRows(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
             curWriteByte = *curData >> dataOffset;
             dataBits = 8 - dataOffset;
             if(bufBits > dataBits) curWriteByte |= *(curData + 1) << dataBits;
-            curWriteByte = (curWriteByte << bufOffset) &
-                    (0xFF >> (8-bufBits-bufOffset));
-
-            curBufByte = buffer + realY*LCD_WIDTH + curX;
-            // If opaque, we want to write directly to the buffer but need to
-            // make sure unused bits around the used bits aren't overwritten.
-            if(opaque) *curBufByte = curWriteByte |
-                    (~(0xFF >> (8-bufBits) << bufOffset) & *curBufByte);
-            // If not, the unused bits are already cleared and won't overwrite
-            // when or'd with the buffer.
-            else *curBufByte |= curWriteByte;
-
-            send(*curBufByte, 1);
-            incrementCoordinates();
+            curWriteByte <<= bufOffset;
+
+            // Only the bits covered by the region may change
+            if(row) mergeByte(row + curX, curWriteByte,
+                    0xFF >> (8-bufBits) << bufOffset, op);
 
             // Update the current row's data pointer
             if(padding) curData += height;
@@ -332,10 +1814,143 @@ int drawRegionRows(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
         y += bufBits;
         realY++;
     }
-    *enableP |= enableM;
+
+    return finishRegion(x, top, width, maxY - top);
+}
+
+int drawRegionRowMajor(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+        const uint8_t * data, uint8_t op) {
+    uint8_t columns[8], stride = (width + 7) >> 3, row, rows, block, cols,
+            curX, column, bufOffset, * upper, * lower;
+    uint16_t mask, curWrite;
+
+    if(!cur->initialized || x >= WIDTH || y >= HEIGHT ||
+            x + width > WIDTH || y + height > HEIGHT || op > ROP_INVERT)
+        return 0;
+    if(width == 0 || height == 0 || !inBand(y, height)) return 1;
+
+    bufOffset = y & 7;
+    // Each pass converts 8 rows of the source into a band of column bytes,
+    // which lands in one bank or straddles two
+    for(row = 0; row < height; row += 8) {
+        rows = height - row > 8 ? 8 : height - row;
+        mask = (0xFF >> (8 - rows)) << bufOffset;
+        upper = bankRow((y + row) >> 3);
+        lower = mask > 0xFF ? bankRow(((y + row) >> 3) + 1) : 0;
+        if(!upper && !lower) continue;
+
+        for(block = 0; block < stride; block++) {
+            transposeBlock(data + row*stride + block, stride, rows, columns);
+            cols = width - (block << 3) > 8 ? 8 : width - (block << 3);
+
+            for(curX = 0; curX < cols; curX++) {
+                curWrite = columns[curX] << bufOffset;
+                column = x + (block << 3) + curX;
+                if(upper) mergeByte(upper + column, curWrite, mask, op);
+                if(lower) mergeByte(lower + column, curWrite >> 8, mask >> 8,
+                        op);
+            }
+        }
+    }
+
+    return finishRegion(x, y, width, height);
+}
+
+#ifndef NOKIA_BANDED
+/*
+ * Helper function to work out a sprite's columns shifted down by shift rows,
+ * split into the bytes of each bank they cover, along with the mask of each
+ * bank's rows it covers.
+ */
+static void shiftSprite(struct nokiaSprite * sprite, uint8_t shift) {
+    uint8_t curX, bank, bytes = (sprite->height + 7) >> 3;
+    uint32_t rows = (((uint32_t)1 << sprite->height) - 1), column;
+    const uint8_t * data = sprite->data;
+
+    for(curX = 0; curX < sprite->width; curX++, data += bytes) {
+        column = data[0];
+        if(bytes > 1) column |= (uint16_t)data[1] << 8;
+        column = (column & rows) << shift;
+        for(bank = 0; bank < SPRITE_BANKS; bank++)
+            sprite->shifted[bank][curX] = column >> (bank << 3);
+    }
+    for(bank = 0; bank < SPRITE_BANKS; bank++)
+        sprite->masks[bank] = (rows << shift) >> (bank << 3);
+    sprite->shift = shift;
+}
+
+/*
+ * Helper function to put back the bytes a shown sprite covers and mark them
+ * dirty. Nothing is sent.
+ */
+static void restoreSprite(struct nokiaSprite * sprite) {
+    uint8_t bank, first = sprite->y >> 3,
+            last = (sprite->y + sprite->height - 1) >> 3;
+
+    for(bank = first; bank <= last; bank++) {
+        memcpy(bankRow(bank) + sprite->x, sprite->saved[bank - first],
+                sprite->width);
+        markDirty(bank, sprite->x, sprite->x + sprite->width - 1);
+    }
+}
+
+int initSprite(struct nokiaSprite * sprite, const uint8_t * data,
+        uint8_t width, uint8_t height, uint8_t op) {
+    if(width == 0 || width > SPRITE_MAX_SIZE || height == 0 ||
+            height > SPRITE_MAX_SIZE || op > ROP_INVERT) return 0;
+
+    sprite->data = data;
+    sprite->width = width;
+    sprite->height = height;
+    sprite->op = op;
+    sprite->shown = 0;
+    // Shifted on the first move
+    sprite->shift = 0xFF;
+
+    return 1;
+}
+
+int moveSprite(struct nokiaSprite * sprite, uint8_t x, uint8_t y) {
+    uint8_t bank, first = y >> 3, last, curX, * row;
+
+    if(!cur->initialized || !rectFits(x, y, sprite->width, sprite->height))
+        return 0;
+    if(sprite->shown) {
+        if(x == sprite->x && y == sprite->y) return 1;
+        restoreSprite(sprite);
+    }
+    if((y & 7) != sprite->shift) shiftSprite(sprite, y & 7);
+
+    // Save what is about to be covered, then merge in whole pre-shifted bytes.
+    // The old and new spans are sent together.
+    last = (y + sprite->height - 1) >> 3;
+    for(bank = first; bank <= last; bank++) {
+        row = bankRow(bank) + x;
+        memcpy(sprite->saved[bank - first], row, sprite->width);
+        for(curX = 0; curX < sprite->width; curX++)
+            mergeByte(row + curX, sprite->shifted[bank - first][curX],
+                    sprite->masks[bank - first], sprite->op);
+        markDirty(bank, x, x + sprite->width - 1);
+    }
+    sprite->x = x;
+    sprite->y = y;
+    sprite->shown = 1;
+    autoFlush();
+
+    return 1;
+}
+
+int hideSprite(struct nokiaSprite * sprite) {
+    if(!cur->initialized) return 0;
+    if(!sprite->shown) return 1;
+
+    restoreSprite(sprite);
+    sprite->shown = 0;
+    autoFlush();
 
     return 1;
 }
+#endif
 
 void love(void) {
 }
@@ -0,0 +1,90 @@
+#include "libnokiadisplay.h"
+#include <string.h>
+
+#ifndef NOKIA_BANDED
+
+#define CELL_WIDTH 6
+
+/*
+ * Helper function to format a fixed point value right aligned in width
+ * characters, without printf. Values that don't fit are shown as all '#'.
+ */
+static void format(char * text, uint8_t width, int32_t value,
+        uint8_t decimals) {
+    uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    uint8_t i = width, digits = 0;
+
+    text[width] = 0;
+
+    // Digits go in from the right, with the point after the decimals and at
+    // least one digit before it
+    do {
+        if(decimals != 0 && digits == decimals) {
+            if(i == 0) break;
+            text[--i] = '.';
+        }
+        if(i == 0) break;
+        text[--i] = '0' + magnitude % 10;
+        magnitude /= 10;
+        digits++;
+    } while(magnitude != 0 || digits <= decimals);
+
+    // Out of room before every digit (and the sign) was in
+    if(magnitude != 0 || digits <= decimals || (value < 0 && i == 0)) {
+        memset(text, '#', width);
+        return;
+    }
+
+    if(value < 0) text[--i] = '-';
+    memset(text, ' ', i);
+}
+
+int initNumber(struct nokiaNumber * number, uint8_t x, uint8_t y,
+        uint8_t width, uint8_t scale) {
+    if(x >= screenWidth() || y >= screenHeight() || width == 0 ||
+            scale == 0 || width > NUMBER_MAX_WIDTH ||
+            width * CELL_WIDTH * scale > screenWidth() - x ||
+            FONT_5X7.height * scale > screenHeight() - y) return 0;
+
+    number->x = x;
+    number->y = y;
+    number->width = width;
+    number->scale = scale;
+    // Nothing matches, so the first update draws every character
+    memset(number->shown, 0, sizeof(number->shown));
+
+    return 1;
+}
+
+int drawNumber(struct nokiaNumber * number, int32_t value) {
+    return drawFixedPoint(number, value, 0);
+}
+
+int drawFixedPoint(struct nokiaNumber * number, int32_t value,
+        uint8_t decimals) {
+    char text[NUMBER_MAX_WIDTH + 1], saved;
+    uint8_t i, end, cell = CELL_WIDTH * number->scale;
+
+    if(!beginFrame()) return 0;
+
+    format(text, number->width, value, decimals);
+
+    // Redraw each run of changed characters as one string
+    for(i = 0; i < number->width; i = end) {
+        for(end = i; end < number->width && text[end] != number->shown[end];
+                end++) number->shown[end] = text[end];
+        if(end == i) {
+            end++;
+            continue;
+        }
+
+        saved = text[end];
+        text[end] = 0;
+        drawFontText(number->x + i*cell, number->y, text + i, &FONT_5X7,
+                number->scale, ROP_COPY);
+        text[end] = saved;
+    }
+
+    return endFrame();
+}
+#endif
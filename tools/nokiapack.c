@@ -0,0 +1,153 @@
+/*
+ * nokiapack - Convert a PBM image into the compressed bitmap format read by
+ * drawCompressedRegion(), written out as C source.
+ *
+ *   nokiapack image.pbm name > image.c
+ *
+ * Both plain (P1) and raw (P4) PBM files are accepted, up to 84x48. The
+ * image is cut into strips 8 pixels tall, each laid out the same way as for
+ * drawRegionColumns (a byte per column, top pixel in the LSB), like the
+ * display's own banks. The strips are stored top to bottom as:
+ *   width, height, then runs of either
+ *   0x00-0x7F  followed by that many plus one literal bytes
+ *   0x80-0xFF  followed by one byte, repeated the low 7 bits plus two times
+ * Runs carry on from one strip to the next, so blank areas and horizontal
+ * lines pack well. The sizes are printed on stderr.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define MAX_WIDTH 84
+#define MAX_HEIGHT 48
+#define MAX_LITERAL 128
+#define MAX_REPEAT 129
+// Shorter repeats are cheaper left in a literal run
+#define MIN_REPEAT 3
+
+static uint8_t pixels[MAX_HEIGHT][MAX_WIDTH];
+static uint8_t strips[MAX_WIDTH * MAX_HEIGHT / 8];
+static uint8_t packed[2 + MAX_WIDTH * MAX_HEIGHT / 8 * 2];
+
+/*
+ * Helper function to read the next number in a PBM header, skipping comments.
+ */
+static int readNumber(FILE * file) {
+    int c, value = 0;
+
+    do {
+        c = fgetc(file);
+        if(c == '#') while(c != '\n' && c != EOF) c = fgetc(file);
+    } while(isspace(c));
+
+    if(!isdigit(c)) return -1;
+    for(; isdigit(c); c = fgetc(file)) value = value*10 + c - '0';
+
+    return value;
+}
+
+/*
+ * Read a PBM file into pixels. Returns false on a malformed or too large file.
+ */
+static int readPbm(FILE * file, int * width, int * height) {
+    int raw, x, y, c = 0;
+
+    if(fgetc(file) != 'P') return 0;
+    c = fgetc(file);
+    if(c != '1' && c != '4') return 0;
+    raw = c == '4';
+
+    *width = readNumber(file);
+    *height = readNumber(file);
+    if(*width < 1 || *width > MAX_WIDTH || *height < 1 || *height > MAX_HEIGHT)
+        return 0;
+
+    for(y = 0; y < *height; y++) {
+        for(x = 0; x < *width; x++) {
+            if(raw) {
+                if(!(x & 7) && (c = fgetc(file)) == EOF) return 0;
+                pixels[y][x] = (c >> (7 - (x & 7))) & 1;
+            } else {
+                do c = fgetc(file); while(isspace(c));
+                if(c != '0' && c != '1') return 0;
+                pixels[y][x] = c == '1';
+            }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Encode count bytes of strip data into out, returning its length.
+ */
+static int pack(const uint8_t * data, int count, uint8_t * out) {
+    int i = 0, length = 0, run, literal = -1;
+
+    while(i < count) {
+        for(run = 1; i + run < count && run < MAX_REPEAT &&
+                data[i + run] == data[i]; run++);
+
+        if(run >= MIN_REPEAT) {
+            out[length++] = 0x80 | (run - 2);
+            out[length++] = data[i];
+            literal = -1;
+            i += run;
+        } else {
+            // Start a new literal run, or extend the current one
+            if(literal < 0 || out[literal] == MAX_LITERAL - 1) {
+                literal = length++;
+                out[literal] = 0;
+            } else {
+                out[literal]++;
+            }
+            out[length++] = data[i++];
+        }
+    }
+
+    return length;
+}
+
+int main(int argc, char ** argv) {
+    int width, height, x, y, length, i;
+    FILE * file;
+
+    if(argc != 3) {
+        fprintf(stderr, "usage: %s image.pbm name\n", argv[0]);
+        return 2;
+    }
+
+    file = strcmp(argv[1], "-") ? fopen(argv[1], "rb") : stdin;
+    if(!file) {
+        perror(argv[1]);
+        return 1;
+    }
+    if(!readPbm(file, &width, &height)) {
+        fprintf(stderr, "%s: not a PBM image of at most %dx%d\n", argv[1],
+                MAX_WIDTH, MAX_HEIGHT);
+        return 1;
+    }
+
+    for(y = 0; y < height; y++)
+        for(x = 0; x < width; x++)
+            strips[y/8*width + x] |= pixels[y][x] << (y & 7);
+
+    packed[0] = width;
+    packed[1] = height;
+    length = 2 + pack(strips, (height + 7) / 8 * width, packed + 2);
+
+    printf("// Generated by nokiapack from %s\n", argv[1]);
+    printf("#include <stdint.h>\n#include <avr/pgmspace.h>\n\n");
+    printf("const uint8_t %s[%d] PROGMEM = {", argv[2], length);
+    for(i = 0; i < length; i++)
+        printf("%s0x%02X,", i % 12 ? " " : "\n    ", packed[i]);
+    printf("\n};\n");
+
+    fprintf(stderr, "%s: %dx%d, %d bytes packed into %d\n", argv[1], width,
+            height, (height + 7) / 8 * width, length);
+
+    return 0;
+}